@@ -0,0 +1,336 @@
+/*
+ * queue_bench.cpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#include "queue_bench.hpp"
+
+#include "cmsis_os2.h"
+
+/* Stream and message buffers exist only in FreeRTOS build */
+#if __has_include("FreeRTOS.h")
+#include "FreeRTOS.h"
+#include "stream_buffer.h"
+#include "message_buffer.h"
+#define QUEUE_BENCH_STREAM_BUFFERS
+#endif
+
+#include <libs/fast_queue.hpp>
+#include <libs/mpsc_queue.hpp>
+
+#include <drivers/stm32f7/core.hpp>
+
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <variant>
+
+//-----------------------------------------------------------------------------
+/* helpers */
+
+namespace
+{
+
+constexpr size_t depth = 32;
+constexpr uint32_t operations = 10000;
+constexpr size_t max_producers = 4;
+
+/* Element types: pointer to event, command request and variant of events */
+using pointer = void*;
+
+struct request
+{
+    char data[64];
+    uint32_t data_size;
+    uint32_t flags;
+};
+
+static_assert(sizeof(request) == 72);
+
+struct button_state_changed
+{
+    bool state;
+};
+
+using event = std::variant<request, button_state_changed, uint32_t>;
+
+/* Adapters with common push/pop interface, all calls are non-blocking */
+
+template<typename E>
+class fast_queue_adapter
+{
+public:
+    using element = E;
+    static constexpr const char *name = "fast_queue";
+    static constexpr bool multi_producer = false;
+
+    bool push(const E &e) { return this->queue.push(e); }
+    bool pop(E &e) { return this->queue.pop(e); }
+
+private:
+    libs::fast_queue<E, depth> queue;
+};
+
+template<typename E>
+class mpsc_queue_adapter
+{
+public:
+    using element = E;
+    static constexpr const char *name = "mpsc_queue";
+    static constexpr bool multi_producer = true;
+
+    bool push(const E &e) { return this->queue.push(e); }
+    bool pop(E &e) { return this->queue.pop(e); }
+
+private:
+    libs::mpsc_queue<E, depth> queue;
+};
+
+template<typename E>
+class message_queue_adapter
+{
+public:
+    using element = E;
+    static constexpr const char *name = "osMessageQueue";
+    static constexpr bool multi_producer = true;
+
+    message_queue_adapter() : queue {osMessageQueueNew(depth, sizeof(E), nullptr)} {}
+    ~message_queue_adapter() { osMessageQueueDelete(this->queue); }
+
+    bool push(const E &e) { return osMessageQueuePut(this->queue, &e, 0, 0) == osOK; }
+    bool pop(E &e) { return osMessageQueueGet(this->queue, &e, nullptr, 0) == osOK; }
+
+private:
+    osMessageQueueId_t queue;
+};
+
+#ifdef QUEUE_BENCH_STREAM_BUFFERS
+/* Buffer holds whole number of elements, so element is never written partially */
+template<typename E>
+class stream_buffer_adapter
+{
+public:
+    using element = E;
+    static constexpr const char *name = "stream buffer";
+    static constexpr bool multi_producer = false;
+
+    stream_buffer_adapter() : buffer {xStreamBufferCreate(depth * sizeof(E), sizeof(E))} {}
+    ~stream_buffer_adapter() { vStreamBufferDelete(this->buffer); }
+
+    bool push(const E &e) { return xStreamBufferSend(this->buffer, &e, sizeof(E), 0) == sizeof(E); }
+    bool pop(E &e) { return xStreamBufferReceive(this->buffer, &e, sizeof(E), 0) == sizeof(E); }
+
+private:
+    StreamBufferHandle_t buffer;
+};
+
+template<typename E>
+class message_buffer_adapter
+{
+public:
+    using element = E;
+    static constexpr const char *name = "message buffer";
+    static constexpr bool multi_producer = false;
+
+    message_buffer_adapter() : buffer {xMessageBufferCreate(depth * (sizeof(E) + sizeof(configMESSAGE_BUFFER_LENGTH_TYPE)))} {}
+    ~message_buffer_adapter() { vMessageBufferDelete(this->buffer); }
+
+    bool push(const E &e) { return xMessageBufferSend(this->buffer, &e, sizeof(E), 0) == sizeof(E); }
+    bool pop(E &e) { return xMessageBufferReceive(this->buffer, &e, sizeof(E), 0) == sizeof(E); }
+
+private:
+    MessageBufferHandle_t buffer;
+};
+#endif
+
+uint32_t cycles()
+{
+    return drivers::core::get_cycles_counter();
+}
+
+void report(const char *queue, const char *element, size_t size, const char *mode, uint32_t elapsed, uint32_t ops)
+{
+    const double cycles_per_op = static_cast<double>(elapsed) / ops;
+    const double ns_per_op = cycles_per_op * 1e9 / drivers::core::get_cycles_frequency();
+
+    std::printf("%-15s %-8s %5u %-8s %10.1f %10.1f\n", queue, element, static_cast<unsigned>(size), mode,
+                ns_per_op, cycles_per_op);
+}
+
+/* Push and pop in one thread, cost of the queue itself without contention */
+template<typename Q>
+uint32_t round_trip(Q &queue)
+{
+    typename Q::element e {};
+
+    const uint32_t start = cycles();
+
+    for (uint32_t i = 0; i < operations; i++)
+    {
+        queue.push(e);
+        queue.pop(e);
+    }
+
+    return cycles() - start;
+}
+
+template<typename Q>
+struct context
+{
+    Q *queue;
+    uint32_t per_producer;
+    uint32_t total;
+    osSemaphoreId_t start;
+    osSemaphoreId_t done;
+};
+
+/* Full or empty queue is waited for by yielding to the other side */
+template<typename Q>
+void producer_thread(void *arg)
+{
+    auto &ctx = *static_cast<context<Q>*>(arg);
+    typename Q::element e {};
+
+    osSemaphoreAcquire(ctx.start, osWaitForever);
+
+    for (uint32_t i = 0; i < ctx.per_producer; i++)
+    {
+        while (!ctx.queue->push(e))
+            osThreadYield();
+    }
+
+    osSemaphoreRelease(ctx.done);
+    osThreadExit();
+}
+
+template<typename Q>
+void consumer_thread(void *arg)
+{
+    auto &ctx = *static_cast<context<Q>*>(arg);
+    typename Q::element e {};
+
+    osSemaphoreAcquire(ctx.start, osWaitForever);
+
+    for (uint32_t i = 0; i < ctx.total; i++)
+    {
+        while (!ctx.queue->pop(e))
+            osThreadYield();
+    }
+
+    osSemaphoreRelease(ctx.done);
+    osThreadExit();
+}
+
+/* Threads wait for start, so they can be terminated safely when scenario can't be set up */
+void terminate(osThreadId_t *threads, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        osThreadTerminate(threads[i]);
+}
+
+/* Producers and consumer in separate threads of the same priority.
+ * Returns false if threads or semaphores could not be created, e.g. when heap runs short. */
+template<typename Q>
+bool threaded(Q &queue, size_t producers, uint32_t &elapsed)
+{
+    context<Q> ctx { &queue, operations / static_cast<uint32_t>(producers),
+                     operations / static_cast<uint32_t>(producers) * static_cast<uint32_t>(producers),
+                     osSemaphoreNew(producers + 1, 0, nullptr), osSemaphoreNew(producers + 1, 0, nullptr) };
+
+    osThreadId_t threads[max_producers + 1] {};
+    size_t created = 0;
+
+    if (ctx.start != nullptr && ctx.done != nullptr)
+    {
+        osThreadAttr_t attr {};
+        attr.priority = osPriorityBelowNormal;
+        attr.stack_size = 1024;
+
+        for (; created < producers + 1; created++)
+        {
+            threads[created] = osThreadNew(created < producers ? producer_thread<Q> : consumer_thread<Q>, &ctx, &attr);
+            if (threads[created] == nullptr)
+                break;
+        }
+    }
+
+    const bool ready = created == producers + 1;
+
+    if (ready)
+    {
+        const uint32_t start = cycles();
+
+        for (size_t i = 0; i < producers + 1; i++)
+            osSemaphoreRelease(ctx.start);
+
+        for (size_t i = 0; i < producers + 1; i++)
+            osSemaphoreAcquire(ctx.done, osWaitForever);
+
+        elapsed = cycles() - start;
+    }
+    else
+    {
+        terminate(threads, created);
+    }
+
+    if (ctx.start != nullptr)
+        osSemaphoreDelete(ctx.start);
+    if (ctx.done != nullptr)
+        osSemaphoreDelete(ctx.done);
+
+    return ready;
+}
+
+template<template<typename> class Q, typename E>
+void bench(const char *element)
+{
+    static const char *modes[max_producers + 1] = { "", "1P1C", "2P1C", "", "4P1C" };
+
+    {
+        auto queue = std::make_unique<Q<E>>();
+        report(Q<E>::name, element, sizeof(E), "1 thread", round_trip(*queue), operations);
+    }
+
+    for (size_t producers = 1; producers <= max_producers; producers *= 2)
+    {
+        if (producers > 1 && !Q<E>::multi_producer)
+            break;
+
+        auto queue = std::make_unique<Q<E>>();
+        uint32_t elapsed = 0;
+
+        if (threaded(*queue, producers, elapsed))
+            report(Q<E>::name, element, sizeof(E), modes[producers], elapsed, operations / producers * producers);
+        else
+            std::printf("%-15s %-8s %5u %-8s skipped, out of memory\n", Q<E>::name, element,
+                        static_cast<unsigned>(sizeof(E)), modes[producers]);
+    }
+}
+
+template<typename E>
+void bench_all(const char *element)
+{
+    bench<fast_queue_adapter, E>(element);
+    bench<mpsc_queue_adapter, E>(element);
+    bench<message_queue_adapter, E>(element);
+#ifdef QUEUE_BENCH_STREAM_BUFFERS
+    bench<stream_buffer_adapter, E>(element);
+    bench<message_buffer_adapter, E>(element);
+#endif
+}
+
+}
+
+//-----------------------------------------------------------------------------
+/* public */
+
+void queue_bench::run(void)
+{
+    std::printf("%-15s %-8s %5s %-8s %10s %10s\n", "queue", "element", "bytes", "threads", "ns/op", "cycles/op");
+
+    bench_all<pointer>("pointer");
+    bench_all<request>("request");
+    bench_all<event>("variant");
+}
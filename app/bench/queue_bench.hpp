@@ -0,0 +1,21 @@
+/*
+ * queue_bench.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef BENCH_QUEUE_BENCH_HPP_
+#define BENCH_QUEUE_BENCH_HPP_
+
+namespace queue_bench
+{
+
+/* Measure libs queues and RTOS primitives, print table with ns/op and cycles/op.
+ * Runs for a few seconds and creates its own threads, so call it from thread of low priority.
+ * On host cycles counter counts nanoseconds, so both columns are equal there. */
+void run(void);
+
+}
+
+#endif /* BENCH_QUEUE_BENCH_HPP_ */
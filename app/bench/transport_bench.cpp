@@ -0,0 +1,157 @@
+/*
+ * transport_bench.cpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#include "transport_bench.hpp"
+
+#include "cmsis_os2.h"
+
+#include <middlewares/active_object.hpp>
+
+#include <drivers/stm32f7/core.hpp>
+
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <variant>
+
+//-----------------------------------------------------------------------------
+/* helpers */
+
+namespace
+{
+
+constexpr uint32_t samples = 1000;
+constexpr uint32_t bursts = 100;
+constexpr size_t burst_size = 16;
+constexpr size_t depth = 32;
+constexpr size_t stack_size = 1024;
+
+struct stamp
+{
+    uint32_t sent_at;
+};
+
+using incoming = std::variant<stamp>;
+
+uint32_t cycles()
+{
+    return drivers::core::get_cycles_counter();
+}
+
+/* Counts dispatched events and their latency, semaphore is released when expected count is reached */
+template<typename transport>
+class sink : public middlewares::active_object<incoming, depth + burst_size, burst_size, transport>
+{
+    using base = middlewares::active_object<incoming, depth + burst_size, burst_size, transport>;
+
+public:
+    sink(osPriority_t priority, osSemaphoreId_t done) : base {"bench sink", priority, stack_size, depth}, done {done} {}
+
+    /* Called before events are sent, sink doesn't run then */
+    void expect(uint32_t count)
+    {
+        this->received = 0;
+        this->expected = count;
+    }
+
+    uint32_t latency_sum = 0;
+    uint32_t latency_max = 0;
+
+private:
+    void dispatch(const typename base::event &e) override
+    {
+        const uint32_t latency = cycles() - std::get<stamp>(e.data).sent_at;
+
+        this->latency_sum += latency;
+        if (latency > this->latency_max)
+            this->latency_max = latency;
+
+        if (++this->received == this->expected)
+            osSemaphoreRelease(this->done);
+    }
+
+    osSemaphoreId_t done;
+    uint32_t received = 0;
+    uint32_t expected = 0;
+};
+
+void report(const char *transport, const char *scenario, uint32_t cycles_per_event, uint32_t max)
+{
+    const double ns_per_event = static_cast<double>(cycles_per_event) * 1e9 / drivers::core::get_cycles_frequency();
+
+    std::printf("%-15s %-9s %10.1f %10lu %10lu\n", transport, scenario, ns_per_event,
+                static_cast<unsigned long>(cycles_per_event), static_cast<unsigned long>(max));
+}
+
+/* Sink has higher priority than sender, so each event is dispatched at once, in the middle of send */
+template<typename transport>
+void latency(const char *name, osSemaphoreId_t done)
+{
+    auto consumer = std::make_unique<sink<transport>>(osPriorityBelowNormal, done);
+
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        consumer->expect(1);
+        consumer->send({ stamp { cycles() } });
+        osSemaphoreAcquire(done, osWaitForever);
+    }
+
+    report(name, "latency", consumer->latency_sum / samples, consumer->latency_max);
+}
+
+/* Sink has the same priority as sender, so it drains whole burst in batches once sender waits */
+template<typename transport>
+void burst(const char *name, osSemaphoreId_t done)
+{
+    auto consumer = std::make_unique<sink<transport>>(osPriorityLow, done);
+    uint32_t elapsed = 0;
+
+    for (uint32_t i = 0; i < bursts; i++)
+    {
+        consumer->expect(burst_size);
+
+        const uint32_t start = cycles();
+
+        for (size_t j = 0; j < burst_size; j++)
+            consumer->send({ stamp { cycles() } });
+
+        osSemaphoreAcquire(done, osWaitForever);
+        elapsed += cycles() - start;
+    }
+
+    report(name, "burst 16", elapsed / (bursts * burst_size), consumer->latency_max);
+}
+
+template<typename transport>
+void bench(const char *name, osSemaphoreId_t done)
+{
+    latency<transport>(name, done);
+    burst<transport>(name, done);
+}
+
+}
+
+//-----------------------------------------------------------------------------
+/* public */
+
+void transport_bench::run(void)
+{
+    osSemaphoreId_t done = osSemaphoreNew(1, 0, nullptr);
+    if (done == nullptr)
+    {
+        std::printf("transport benchmark skipped, out of memory\n");
+        return;
+    }
+
+    std::printf("%-15s %-9s %10s %10s %10s\n", "transport", "scenario", "ns/evt", "cycles/evt", "max cycles");
+
+    bench<middlewares::os_queue_transport>("os_queue", done);
+    bench<middlewares::mpsc_transport<depth>>("mpsc", done);
+    bench<middlewares::notify_transport<depth>>("notify", done);
+
+    osSemaphoreDelete(done);
+}
@@ -0,0 +1,21 @@
+/*
+ * transport_bench.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef BENCH_TRANSPORT_BENCH_HPP_
+#define BENCH_TRANSPORT_BENCH_HPP_
+
+namespace transport_bench
+{
+
+/* Measure active object transports (kernel queue, MPSC queue, task notification) with cycles counter:
+ * latency from send to dispatch in thread of higher priority, and cost per event of burst drained in batches.
+ * Creates its own active objects, call it from thread of low priority (runs with osPriorityLow). */
+void run(void);
+
+}
+
+#endif /* BENCH_TRANSPORT_BENCH_HPP_ */
@@ -9,6 +9,7 @@
 #define CONFIG_HPP_
 
 #include <cstdint>
+#include <cstddef>
 
 namespace config
 {
@@ -20,6 +21,44 @@ constexpr inline uint8_t net_mask[4] = { 255, 255, 255, 0 };
 constexpr inline uint8_t gateway_addr[4] = { 192, 168, 1, 1 };
 constexpr inline uint8_t dns_addr[4] = { 208, 67, 222, 222 };
 
+/* UDP services of server, each port gets own socket, all are served by one task */
+enum class udp_service : uint8_t
+{
+    command,    /* Text commands executed by controller */
+    discovery,  /* Any datagram is answered with host name and IP address */
+};
+
+struct udp_port
+{
+    uint16_t number;
+    udp_service service;
+};
+
+constexpr inline udp_port udp_ports[] =
+{
+    { 7, udp_service::command },
+    { 30303, udp_service::discovery },
+};
+
+/* Datagrams per second and burst allowed for each client address, excess is dropped in IP task */
+constexpr inline uint32_t client_rate = 200;
+constexpr inline uint32_t client_burst = 32;
+
+/* Clients tracked at once, the least recently seen one is forgotten */
+constexpr inline size_t rate_limited_clients = 8;
+
+/* Answer read-only commands directly in IP task, without going through active objects */
+constexpr inline bool inline_commands = true;
+
+/* Pack responses to the same client into one datagram, client has to split it (text responses end with newline,
+ * binary ones carry header with count of results). Batch is sent when the next response doesn't fit,
+ * when it waits longer than the budget or when server has no more events queued. */
+constexpr inline bool coalesce_responses = false;
+constexpr inline uint32_t coalesce_budget_us = 200;
+
+/* Clients with batch pending at once, batch of the oldest one is sent to make space */
+constexpr inline size_t coalesced_clients = 2;
+
 }
 
 #endif /* CONFIG_HPP_ */
@@ -0,0 +1,121 @@
+/*
+ * binary_command.cpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#include "binary_command.hpp"
+
+#include <cstring>
+
+using namespace binary_command;
+
+//-----------------------------------------------------------------------------
+/* helpers */
+
+namespace
+{
+
+constexpr size_t tlv_header_size = 2;
+
+uint16_t get_u16(const char *p)
+{
+    return static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8);
+}
+
+uint32_t get_u32(const char *p)
+{
+    return get_u16(p) | (static_cast<uint32_t>(get_u16(p + 2)) << 16);
+}
+
+void put_u16(char *p, uint16_t v)
+{
+    p[0] = static_cast<char>(v);
+    p[1] = static_cast<char>(v >> 8);
+}
+
+void put_u32(char *p, uint32_t v)
+{
+    put_u16(p, static_cast<uint16_t>(v));
+    put_u16(p + 2, static_cast<uint16_t>(v >> 16));
+}
+
+}
+
+//-----------------------------------------------------------------------------
+/* public */
+
+bool reader::open(std::string_view data)
+{
+    if (data.size() < header_size || !is_binary(data) || static_cast<uint8_t>(data[1]) != version)
+        return false;
+
+    this->total = get_u16(&data[2]);
+    this->id = get_u32(&data[4]);
+    this->rest = data.substr(header_size);
+    this->decoded = 0;
+    this->broken = false;
+    return true;
+}
+
+bool reader::next(tlv &cmd)
+{
+    if (this->decoded == this->total || this->broken)
+        return false;
+
+    if (this->rest.size() < tlv_header_size ||
+        this->rest.size() - tlv_header_size < static_cast<uint8_t>(this->rest[1]))
+    {
+        this->broken = true;
+        return false;
+    }
+
+    const size_t value_size = static_cast<uint8_t>(this->rest[1]);
+
+    cmd.type = static_cast<uint8_t>(this->rest[0]);
+    cmd.value = this->rest.substr(tlv_header_size, value_size);
+
+    this->rest.remove_prefix(tlv_header_size + value_size);
+    this->decoded++;
+    return true;
+}
+
+writer::writer(char *buf, size_t size, uint32_t request_id) :
+buf {buf}, size {size}, length {header_size}, id {request_id}, count {0}
+{
+
+}
+
+bool writer::add(uint8_t type, status st, std::string_view data)
+{
+    /* Status is the first byte of value */
+    const size_t value_size = 1 + data.size();
+
+    if (value_size > UINT8_MAX || this->length + tlv_header_size + value_size > this->size)
+        return false;
+
+    char *p = this->buf + this->length;
+    p[0] = static_cast<char>(type);
+    p[1] = static_cast<char>(value_size);
+    p[2] = static_cast<char>(st);
+
+    if (!data.empty())
+        std::memcpy(p + 3, data.data(), data.size());
+
+    this->length += tlv_header_size + value_size;
+    this->count++;
+    return true;
+}
+
+size_t writer::finish()
+{
+    if (this->size < header_size)
+        return 0;
+
+    this->buf[0] = static_cast<char>(magic);
+    this->buf[1] = static_cast<char>(version);
+    put_u16(&this->buf[2], this->count);
+    put_u32(&this->buf[4], this->id);
+    return this->length;
+}
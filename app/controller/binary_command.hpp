@@ -0,0 +1,104 @@
+/*
+ * binary_command.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef CONTROLLER_BINARY_COMMAND_HPP_
+#define CONTROLLER_BINARY_COMMAND_HPP_
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Binary batched command protocol, all fields are little-endian:
+ *
+ * header:  magic (1) | version (1) | count (2) | request id (4)
+ * command: type (1) | length (1) | value (length)
+ *
+ * Request carries 'count' commands, response has the same header (with count of results)
+ * followed by one result per command: type (1) | length (1) | status (1) | data (length - 1).
+ * Magic byte is not printable, so datagram can't be mistaken for text command.
+ */
+namespace binary_command
+{
+
+inline constexpr uint8_t magic = 0xB5;
+inline constexpr uint8_t version = 1;
+inline constexpr size_t header_size = 8;
+
+enum class type : uint8_t
+{
+    error = 0,      /* Result only, request could not be decoded entirely */
+    led_set = 1,    /* Value: state (1) */
+    led_get = 2,    /* Result data: state (1) */
+    button_get = 3, /* Result data: pressed (1) */
+    print = 4,      /* Value: text */
+};
+
+enum class status : uint8_t
+{
+    ok,
+    unsupported,
+    invalid,
+};
+
+/* Command of request, value points into request data */
+struct tlv
+{
+    uint8_t type;
+    std::string_view value;
+};
+
+inline bool is_binary(std::string_view data)
+{
+    return !data.empty() && static_cast<uint8_t>(data.front()) == magic;
+}
+
+/* Decodes request in place, without allocation */
+class reader
+{
+public:
+    /* Returns false if header is invalid or version is not supported */
+    bool open(std::string_view data);
+
+    /* Returns false after the last command or when the rest of request is malformed */
+    bool next(tlv &cmd);
+
+    bool malformed() const { return this->broken; }
+    uint32_t request_id() const { return this->id; }
+    uint16_t count() const { return this->total; }
+
+private:
+    std::string_view rest;
+    uint32_t id = 0;
+    uint16_t total = 0;
+    uint16_t decoded = 0;
+    bool broken = false;
+};
+
+/* Encodes response in given buffer, results which don't fit are left out */
+class writer
+{
+public:
+    writer(char *buf, size_t size, uint32_t request_id);
+
+    /* Returns false if result doesn't fit */
+    bool add(uint8_t type, status st, std::string_view data = {});
+
+    /* Writes header, returns length of response (0 if even header doesn't fit) */
+    size_t finish();
+
+private:
+    char *buf;
+    size_t size;
+    size_t length;
+    uint32_t id;
+    uint16_t count;
+};
+
+}
+
+#endif /* CONTROLLER_BINARY_COMMAND_HPP_ */
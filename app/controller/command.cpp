@@ -0,0 +1,64 @@
+/*
+ * command.cpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#include "command.hpp"
+
+#include <atomic>
+
+//-----------------------------------------------------------------------------
+/* helpers */
+
+namespace
+{
+
+command::inline_command inline_commands[command::max_inline_commands];
+std::atomic<size_t> inline_commands_count {0};
+
+}
+
+//-----------------------------------------------------------------------------
+/* public */
+
+bool command::parse(std::string_view data, text &cmd)
+{
+    const size_t delim_pos = data.find(' ');
+    if (delim_pos == data.npos)
+        return false;
+
+    const size_t end_pos = data.find('\n', delim_pos);
+    if (end_pos == data.npos)
+        return false;
+
+    cmd.name = data.substr(0, delim_pos);
+    cmd.arg = data.substr(delim_pos + 1, end_pos - delim_pos - 1);
+    return true;
+}
+
+bool command::register_inline(const inline_command &cmd)
+{
+    const size_t count = inline_commands_count.load(std::memory_order_relaxed);
+    if (count == max_inline_commands)
+        return false;
+
+    /* Publish entry after it is written */
+    inline_commands[count] = cmd;
+    inline_commands_count.store(count + 1, std::memory_order_release);
+    return true;
+}
+
+const command::inline_command *command::find_inline(const text &cmd)
+{
+    const size_t count = inline_commands_count.load(std::memory_order_acquire);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (inline_commands[i].name == cmd.name && inline_commands[i].arg == cmd.arg)
+            return &inline_commands[i];
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,47 @@
+/*
+ * command.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef CONTROLLER_COMMAND_HPP_
+#define CONTROLLER_COMMAND_HPP_
+
+#include <string_view>
+#include <cstddef>
+
+namespace command
+{
+
+/* Text command in form of 'name arg\n', views point into request data */
+struct text
+{
+    std::string_view name;
+    std::string_view arg;
+};
+
+bool parse(std::string_view data, text &cmd);
+
+/* Formats response into buf like snprintf, returns its length */
+using responder = int (*)(void *ctx, char *buf, size_t size);
+
+/* Command which neither blocks nor changes state, so it can be answered in any thread,
+ * also directly in IP task without going through active objects */
+struct inline_command
+{
+    std::string_view name;
+    std::string_view arg;
+    responder respond;
+    void *ctx;
+};
+
+inline constexpr size_t max_inline_commands = 8;
+
+/* Commands are registered by one thread at startup, lookup may run in other threads meanwhile */
+bool register_inline(const inline_command &cmd);
+const inline_command *find_inline(const text &cmd);
+
+}
+
+#endif /* CONTROLLER_COMMAND_HPP_ */
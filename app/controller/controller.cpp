@@ -6,10 +6,17 @@
  */
 
 #include "controller.hpp"
+#include "command.hpp"
+#include "binary_command.hpp"
 #include "app/server/server.hpp"
+#include "app/bench/queue_bench.hpp"
+#include "app/bench/transport_bench.hpp"
+#include "app/config.hpp"
 
-#include <string>
 #include <cstdio>
+#include <atomic>
+#include <iterator>
+#include <algorithm>
 
 namespace events = controller_events;
 
@@ -19,27 +26,175 @@ namespace events = controller_events;
 namespace
 {
 
-void button_timer_cb(void *arg)
+/* Set while benchmark runs, concurrent runs would disturb each other's numbers */
+std::atomic<bool> bench_running {false};
+
+/* Benchmark to run, written only by the one who sets running flag */
+void (*bench_function)(void);
+
+/* Benchmark runs in its own thread, below application, and prints results to console */
+void bench_thread(void *arg)
 {
-    if (arg == nullptr)
-        return;
+    bench_function();
+    bench_running.store(false);
+    osThreadExit();
+}
+
+/* Returns state of benchmark for command response */
+const char *start_bench(void (*function)(void))
+{
+    if (bench_running.exchange(true))
+        return "busy";
+
+    bench_function = function;
+
+    osThreadAttr_t attr {};
+    attr.name = "bench";
+    attr.priority = osPriorityLow;
+    attr.stack_size = 2048;
+
+    if (osThreadNew(bench_thread, nullptr, &attr) == nullptr)
+    {
+        bench_running.store(false);
+        return "failed";
+    }
+
+    return "started";
+}
+
+/* Text commands which only act, they take no response buffer */
+bool has_response(const command::text &cmd)
+{
+    if (cmd.name == "print")
+        return false;
+
+    return !(cmd.name == "led" && (cmd.arg == "on" || cmd.arg == "off"));
+}
+
+/* Adds length of formatted part to response length, which is limited by buffer size */
+size_t append(size_t length, int n, size_t size)
+{
+    if (n < 0)
+        return length;
+
+    return std::min(length + n, size > 0 ? size - 1 : 0);
+}
+
+/* Prints datagrams per wakeup histogram to console and formats summary as command response */
+int print_rx_stats(char *buf, size_t size)
+{
+    const auto stats = server::get_rx_statistics();
+    unsigned long wakeups = 0, datagrams = 0;
+
+    printf("rx datagrams per wakeup |");
+
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        printf(" %lu", static_cast<unsigned long>(stats[i]));
 
-    auto *button = static_cast<hal::button*>(arg);
+        wakeups += stats[i];
+        datagrams += stats[i] * i;
+    }
+
+    printf("\n");
 
-    button->debounce();
+    const auto inline_stats = server::get_inline_statistics();
 
-    controller::event e { events::button_state_changed {} };
+    return std::snprintf(buf, size, ">rx wakeups %lu datagrams %lu empty %lu budget %lu inline %lu failed %lu\n", wakeups, datagrams,
+                         static_cast<unsigned long>(stats.front()), static_cast<unsigned long>(stats.back()),
+                         static_cast<unsigned long>(inline_stats.answered), static_cast<unsigned long>(inline_stats.failed));
+}
 
-    if (button->was_pressed())
+/* Formats counters of each server port as command response */
+int print_port_stats(char *buf, size_t size)
+{
+    size_t length = 0;
+
+    for (const auto &port : server::get_port_statistics())
     {
-        std::get<events::button_state_changed>(e.data).state = true;
-        controller::instance->send(e);
+        const int n = std::snprintf(buf + length, size - length, ">port %u rx %lu dropped %lu budget %lu\n",
+                                    port.port, static_cast<unsigned long>(port.received),
+                                    static_cast<unsigned long>(port.dropped), static_cast<unsigned long>(port.budget_used));
+        length = append(length, n, size);
     }
-    else if (button->was_released())
+
+    return length;
+}
+
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+void print_histogram(const char *name, size_t type, const char *metric, const middlewares::latency_histogram &h)
+{
+    if (h.count == 0)
+        return;
+
+    printf("%s[%u] %s: n=%lu max=%lu |", name, static_cast<unsigned>(type), metric,
+           static_cast<unsigned long>(h.count), static_cast<unsigned long>(h.max));
+
+    for (auto bucket : h.buckets)
+        printf(" %lu", static_cast<unsigned long>(bucket));
+
+    printf("\n");
+}
+
+/* Prints histograms to console and formats summary as command response */
+template<typename T>
+int print_stats(const char *name, const T &ao, char *buf, size_t size)
+{
+    const auto &stats = ao.get_latency_statistics();
+    const auto high_water = ao.get_depth_high_water();
+    uint32_t max_wait = 0, max_run = 0;
+
+    printf("%s: cycles histogram buckets start at %u, each next bucket doubles\n",
+           name, 1u << middlewares::latency_histogram::bucket_shift);
+
+    for (size_t i = 0; i < std::size(stats.queue_wait); i++)
     {
-        std::get<events::button_state_changed>(e.data).state = false;
-        controller::instance->send(e);
+        print_histogram(name, i, "wait", stats.queue_wait[i]);
+        print_histogram(name, i, "run", stats.handler[i]);
+
+        max_wait = std::max(max_wait, stats.queue_wait[i].max);
+        max_run = std::max(max_run, stats.handler[i].max);
     }
+
+    return std::snprintf(buf, size, ">%s wait %lu run %lu hw %u/%u\n", name,
+                         static_cast<unsigned long>(max_wait), static_cast<unsigned long>(max_run),
+                         high_water[0], high_water[1]);
+}
+#endif
+
+int print_rate_limit_stats(char *buf, size_t size)
+{
+    const auto stats = server::get_rate_limit_statistics();
+
+    return std::snprintf(buf, size, ">limit allowed %lu dropped %lu evicted %lu rejected %lu\n", static_cast<unsigned long>(stats.allowed),
+                         static_cast<unsigned long>(stats.dropped), static_cast<unsigned long>(stats.evicted),
+                         static_cast<unsigned long>(stats.rejected));
+}
+
+int print_coalesce_stats(char *buf, size_t size)
+{
+    const auto stats = server::get_coalesce_statistics();
+
+    return std::snprintf(buf, size, ">coalesce responses %lu datagrams %lu full %lu expired %lu\n",
+                         static_cast<unsigned long>(stats.responses), static_cast<unsigned long>(stats.datagrams),
+                         static_cast<unsigned long>(stats.full), static_cast<unsigned long>(stats.expired));
+}
+
+/* All counters in one datagram, response may take whole UDP payload */
+int print_all_stats(char *buf, size_t size)
+{
+    size_t length = 0;
+
+    length = append(length, print_rx_stats(buf + length, size - length), size);
+    length = append(length, print_port_stats(buf + length, size - length), size);
+    length = append(length, print_rate_limit_stats(buf + length, size - length), size);
+    length = append(length, print_coalesce_stats(buf + length, size - length), size);
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+    length = append(length, print_stats("controller", *controller::instance, buf + length, size - length), size);
+    length = append(length, print_stats("server", *server::instance, buf + length, size - length), size);
+#endif
+
+    return length;
 }
 
 }
@@ -52,22 +207,42 @@ void controller::dispatch(const event& e)
     std::visit([this](auto &&e) { this->event_handler(e); }, e.data);
 }
 
-void controller::event_handler(const events::command_request &e)
+void controller::dispatch_idle()
 {
-    const std::string cmd_req = e.data;
+    /* All queued requests were handled and their buffers released */
+    server::resume_rx();
+}
 
-    size_t delim_pos = cmd_req.find(" ");
-    if (delim_pos == cmd_req.npos)
-        return;
+void controller::execute(std::string_view data, const freertos_sockaddr &client, Socket_t socket)
+{
+    /* Both protocols share the port, binary one starts with magic byte */
+    const bool binary = binary_command::is_binary(data);
 
-    const std::string cmd = cmd_req.substr(0, delim_pos);
-    size_t end_pos = cmd_req.find("\n");
-    if (end_pos == cmd_req.npos)
+    command::text cmd_req;
+    if (!binary && !command::parse(data, cmd_req))
         return;
 
-    const std::string arg = cmd_req.substr(delim_pos + 1, end_pos - delim_pos - 1);
+    /* Response is formatted directly in network buffer, then sent with zero-copy.
+     * Without a buffer (IP stack has run out of them) command is still executed, only its response is lost.
+     * Buffer of response which is not sent is released with the handle (or with dropped event). */
+    udp_payload rsp = (binary || has_response(cmd_req)) ? udp_payload::allocate() : udp_payload {};
+
+    const int rsp_size = binary ? this->execute_binary(data, rsp.data(), rsp.size()) :
+                                  this->execute_text(cmd_req, rsp.data(), rsp.size());
+
+    if (rsp_size > 0 && rsp.valid())
+    {
+        rsp.resize(std::min<size_t>(rsp_size, rsp.size()));
+        server::instance->try_send({ server_events::command_response { std::move(rsp), client, socket } });
+    }
+}
 
-    server_events::command_response cmd_rsp {};
+int controller::execute_text(const command::text &cmd_req, char *buf, size_t size)
+{
+    const auto &cmd = cmd_req.name;
+    const auto &arg = cmd_req.arg;
+
+    int rsp_size = 0;
 
     if (cmd == "led")
     {
@@ -76,24 +251,124 @@ void controller::event_handler(const events::command_request &e)
         else if (arg == "off")
             this->led.set(false);
         else if (arg == "get")
-            cmd_rsp.data_size = std::snprintf(cmd_rsp.data, sizeof(cmd_rsp.data), ">led is %s\n",(this->led.get() ? "on" : "off"));
+            rsp_size = led_state(this, buf, size);
     }
     else if (cmd == "button")
     {
         if (arg == "get")
-            cmd_rsp.data_size = std::snprintf(cmd_rsp.data, sizeof(cmd_rsp.data), ">button is %s\n",(this->button.is_pressed() ? "pressed" : "released"));
+            rsp_size = button_state(this, buf, size);
     }
     else if (cmd == "print")
     {
-        puts(arg.c_str());
+        printf("%.*s\n", static_cast<int>(arg.size()), arg.data());
+    }
+    else if (cmd == "bench")
+    {
+        if (arg == "queues")
+            rsp_size = std::snprintf(buf, size, ">benchmark %s\n", start_bench(queue_bench::run));
+        else if (arg == "transports")
+            rsp_size = std::snprintf(buf, size, ">benchmark %s\n", start_bench(transport_bench::run));
+    }
+    else if (cmd == "stats")
+    {
+        if (arg == "rx")
+            rsp_size = print_rx_stats(buf, size);
+        else if (arg == "ports")
+            rsp_size = print_port_stats(buf, size);
+        else if (arg == "limit")
+            rsp_size = print_rate_limit_stats(buf, size);
+        else if (arg == "coalesce")
+            rsp_size = print_coalesce_stats(buf, size);
+        else if (arg == "all")
+            rsp_size = print_all_stats(buf, size);
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+        else if (arg == "controller")
+            rsp_size = print_stats("controller", *controller::instance, buf, size);
+        else if (arg == "server")
+            rsp_size = print_stats("server", *server::instance, buf, size);
+#endif
     }
     else
     {
-        cmd_rsp.data_size = std::snprintf(cmd_rsp.data, sizeof(cmd_rsp.data), ">unsupported command\n");
+        rsp_size = std::snprintf(buf, size, ">unsupported command\n");
     }
 
-    if (cmd_rsp.data_size > 0)
-        server::instance->send(server::event { cmd_rsp });
+    return rsp_size;
+}
+
+int controller::execute_binary(std::string_view data, char *buf, size_t size)
+{
+    using binary_command::type;
+    using binary_command::status;
+
+    binary_command::reader req;
+    if (!req.open(data))
+        return 0;
+
+    binary_command::writer rsp { buf, size, req.request_id() };
+    binary_command::tlv cmd;
+
+    /* Commands are executed even if their results don't fit in response */
+    while (req.next(cmd))
+    {
+        switch (static_cast<type>(cmd.type))
+        {
+        case type::led_set:
+            if (cmd.value.size() != 1)
+            {
+                rsp.add(cmd.type, status::invalid);
+                break;
+            }
+
+            this->led.set(cmd.value[0] != 0);
+            rsp.add(cmd.type, status::ok);
+            break;
+        case type::led_get:
+        {
+            const char state = this->led.get() ? 1 : 0;
+            rsp.add(cmd.type, status::ok, { &state, 1 });
+            break;
+        }
+        case type::button_get:
+        {
+            const char pressed = this->button.is_pressed() ? 1 : 0;
+            rsp.add(cmd.type, status::ok, { &pressed, 1 });
+            break;
+        }
+        case type::print:
+            printf("%.*s\n", static_cast<int>(cmd.value.size()), cmd.value.data());
+            rsp.add(cmd.type, status::ok);
+            break;
+        default:
+            rsp.add(cmd.type, status::unsupported);
+            break;
+        }
+    }
+
+    if (req.malformed())
+        rsp.add(static_cast<uint8_t>(type::error), status::invalid);
+
+    return rsp.finish();
+}
+
+int controller::led_state(void *ctx, char *buf, size_t size)
+{
+    controller *this_ = static_cast<controller*>(ctx);
+    return std::snprintf(buf, size, ">led is %s\n", (this_->led.get() ? "on" : "off"));
+}
+
+int controller::button_state(void *ctx, char *buf, size_t size)
+{
+    controller *this_ = static_cast<controller*>(ctx);
+    return std::snprintf(buf, size, ">button is %s\n", (this_->button.is_pressed() ? "pressed" : "released"));
+}
+
+void controller::event_handler(const events::command_request &e)
+{
+    /* Request buffer is released when handler returns */
+    const udp_payload request = std::move(e.payload);
+
+    this->execute(request.view(), e.client, e.socket);
 }
 
 void controller::event_handler(const events::button_state_changed &e)
@@ -101,15 +376,31 @@ void controller::event_handler(const events::button_state_changed &e)
     printf("Button %s\n", e.state ? "pressed" : "released");
 }
 
+void controller::event_handler(const events::button_debounce_timeout &e)
+{
+    this->button.debounce();
+
+    if (this->button.was_pressed())
+        this->event_handler(events::button_state_changed { true });
+    else if (this->button.was_released())
+        this->event_handler(events::button_state_changed { false });
+}
+
 //-----------------------------------------------------------------------------
 /* public */
 
-controller::controller() : active_object("controller", osPriorityNormal, 2048)
+controller::controller(middlewares::cooperative_kernel &kernel, uint8_t priority) :
+static_active_object("controller", kernel, priority),
+button_timer {*this, { events::button_debounce_timeout {} }}
 {
-    /* Create timer for button debouncing */
-    this->button_timer = osTimerNew(button_timer_cb, osTimerPeriodic, &this->button, NULL);
-    assert(this->button_timer != nullptr);
-    osTimerStart(this->button_timer, 20);
+    /* Start timer for button debouncing */
+    this->button_timer.arm(20, 20);
+
+    if (config::inline_commands)
+    {
+        command::register_inline({ "led", "get", led_state, this });
+        command::register_inline({ "button", "get", button_state, this });
+    }
 }
 
 controller::~controller()
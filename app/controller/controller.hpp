@@ -13,46 +13,79 @@
 #include <hal/hal_led.hpp>
 #include <hal/hal_button.hpp>
 
-#include <middlewares/active_object.hpp>
+#include <middlewares/static_active_object.hpp>
+#include <middlewares/time_event.hpp>
+
+#include <app/server/udp_payload.hpp>
+#include <app/controller/command.hpp>
+
+#include "FreeRTOS_Sockets.h"
+
+#include <string_view>
 
 namespace controller_events
 {
 
+/* Parsed in place in network buffer, which is released after the command is executed.
+ * Response is sent back to the client address of its request, from the socket which received it. */
 struct command_request
 {
-    char data[64];
-    size_t data_size;
+    mutable udp_payload payload;    /* Handler moves it out of the event it gets as const */
+    freertos_sockaddr client;
+    Socket_t socket;
 };
 
 struct button_state_changed
 {
+    static constexpr auto lane = middlewares::event_lane::high;
     bool state;
 };
 
+struct button_debounce_timeout
+{
+    static constexpr auto lane = middlewares::event_lane::high;
+};
+
 using incoming = std::variant
 <
     command_request,
-    button_state_changed
+    button_state_changed,
+    button_debounce_timeout
 >;
 
+/* Payloads are passed by handle, so events stay small whatever the datagram size */
+static_assert(sizeof(incoming) <= 8 * sizeof(void*));
+
 }
 
-class controller : public middlewares::active_object<controller_events::incoming>
+class controller : public middlewares::static_active_object<controller_events::incoming, 0, 32, 8, middlewares::notify_transport<32>>
 {
 public:
-    controller();
+    controller(middlewares::cooperative_kernel &kernel, uint8_t priority);
     ~controller();
 
 private:
     void dispatch(const event &e) override;
+    void dispatch_idle() override;
 
     /* Event handlers */
     void event_handler(const controller_events::command_request &e);
     void event_handler(const controller_events::button_state_changed &e);
+    void event_handler(const controller_events::button_debounce_timeout &e);
+
+    void execute(std::string_view data, const freertos_sockaddr &client, Socket_t socket);
+
+    /* Execute request and format response into buf, return length of response */
+    int execute_text(const command::text &cmd_req, char *buf, size_t size);
+    int execute_binary(std::string_view data, char *buf, size_t size);
+
+    /* Responders of read-only commands, they may also be called in IP task */
+    static int led_state(void *ctx, char *buf, size_t size);
+    static int button_state(void *ctx, char *buf, size_t size);
 
     hal::leds::debug led;
     hal::buttons::blue_btn button;
-    osTimerId_t button_timer;
+    middlewares::time_event<controller> button_timer;
 };
 
 
@@ -9,28 +9,77 @@
 
 #include "app/config.hpp"
 #include "app/controller/controller.hpp"
+#include "app/controller/command.hpp"
 
 #include "hal/hal_random.hpp"
 
+#include <libs/rate_limiter.hpp>
+
+#include <drivers/stm32f7/core.hpp>
+
 #include <cstdio>
 #include <cassert>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <utility>
 
 namespace events = server_events;
 
 //-----------------------------------------------------------------------------
 /* helpers */
 
+/* Ports with data which server was notified about and has not drained yet, bit per entry of config::udp_ports */
+static std::atomic<uint32_t> rx_pending_ports {0};
+static_assert(std::size(config::udp_ports) <= 32, "Pending ports must fit in bitmask");
+
+/* Set when draining was left until controller releases request buffers, see server::resume_rx() */
+static std::atomic<bool> rx_waiting {false};
+
+/* Histogram of datagrams received per wakeup, see server::get_rx_statistics() */
+static std::atomic<uint32_t> rx_per_wakeup[server::rx_budget + 1] {};
+
+/* Counters of each port, see server::get_port_statistics() */
+static struct
+{
+    std::atomic<uint32_t> received, dropped, budget_used;
+} port_counters[std::size(config::udp_ports)];
+
+/* Requests answered in IP task, see server::get_inline_statistics() */
+static std::atomic<uint32_t> inline_responses {0}, inline_failures {0};
+
+/* Counters of response coalescing, see server::get_coalesce_statistics() */
+static struct
+{
+    std::atomic<uint32_t> responses, datagrams, full, expired;
+} coalesce_counters;
+
+/* Token buckets of clients, used only in IP task */
+static libs::rate_limiter<config::rate_limited_clients> rate_limit { config::client_rate, config::client_burst };
+
+/* Server sends responses before controller takes next requests, so controller allocates at most one response
+ * per held request. Each batch holds a TX buffer, discovery response and request answered in IP task
+ * (which may preempt server) take one each. */
+static_assert(udp_payload::max_rx_held + config::coalesced_clients + 2 <= udp_payload::max_tx_held,
+              "Response buffer must be available for each request");
+
+static bool post_rx_notification(void)
+{
+    static const server::event e { events::udp_data_received { }, server::event::flags::immutable };
+    return server::instance->try_send(e);
+}
+
 void vApplicationIPNetworkEventHook(eIPCallbackEvent_t eNetworkEvent)
 {
     if (eNetworkEvent == eNetworkUp)
     {
         static const server::event e { events::network_up {}, server::event::flags::immutable };
-        server::instance->send(e);
+        server::instance->try_send(e);
     }
     else if (eNetworkEvent == eNetworkDown)
     {
         static const server::event e { events::network_down {}, server::event::flags::immutable };
-        server::instance->send(e);
+        server::instance->try_send(e);
     }
 }
 
@@ -43,8 +92,7 @@ eDHCPCallbackAnswer_t xApplicationDHCPHook(eDHCPCallbackPhase_t eDHCPPhase, uint
 {
     if (eDHCPPhase == eDHCPPhasePreRequest)
     {
-        static server::event e { events::ip_addr_assigned { ulIPAddress }, server::event::flags::immutable };
-        server::instance->send(e);
+        server::instance->try_send({ events::ip_addr_assigned { ulIPAddress } });
     }
 
     return eDHCPContinue;
@@ -61,13 +109,100 @@ uint32_t ulApplicationGetNextSequenceNumber(uint32_t ulSourceAddress, uint16_t u
     return  hal::random::get();
 }
 
-static BaseType_t socket_udp_receive_callback(Socket_t socket, void * data, size_t length, const struct freertos_sockaddr * from, const struct freertos_sockaddr * dest)
+template<typename T>
+static bool same_client(const T &batch, const freertos_sockaddr &client, Socket_t socket)
 {
-    static const server::event e { events::udp_data_received { }, server::event::flags::immutable };
-    server::instance->send(e);
+    return batch.socket == socket && batch.client.sin_addr == client.sin_addr && batch.client.sin_port == client.sin_port;
+}
+
+/* Answers registered stateless command in IP task, returns false if datagram must go the regular way */
+static bool respond_inline(Socket_t socket, std::string_view data, const struct freertos_sockaddr *from)
+{
+    command::text cmd;
+    if (!command::parse(data, cmd))
+        return false;
+
+    const command::inline_command *handler = command::find_inline(cmd);
+    if (handler == nullptr)
+        return false;
+
+    udp_payload rsp = udp_payload::allocate();
+    if (!rsp.valid())
+        return false;
+
+    const int rsp_size = handler->respond(handler->ctx, rsp.data(), rsp.size());
+    if (rsp_size <= 0)
+        return true;
+
+    rsp.resize(std::min<size_t>(rsp_size, rsp.size()));
+
+    /* Sending from IP task never blocks, it queues the packet to itself.
+     * Buffer which is not accepted is released with the handle. */
+    if (FreeRTOS_sendto(socket, rsp.data(), rsp.size(), FREERTOS_ZERO_COPY, from, sizeof(*from)) == static_cast<int32_t>(rsp.size()))
+    {
+        rsp.hand_over();
+        inline_responses.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        inline_failures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return true;
+}
+
+static BaseType_t notify_rx(size_t port)
+{
+    const uint32_t bit = 1ul << port;
+
+    /* Port is marked for the server, which drains only marked ones. Notification is posted only
+     * on transition from no pending port, pending one is served in the same wakeup.
+     * Server task has lower priority than IP task, so it can't drain the socket between
+     * this callback and queuing of the datagram. */
+    if (rx_pending_ports.fetch_or(bit) != 0)
+        return 0;
+
+    /* Never block IP task, drop the datagram if server can't be notified about it.
+     * Server can't run in between (IP task has higher priority), so no other bit is set now. */
+    if (!post_rx_notification())
+    {
+        rx_pending_ports.fetch_and(~bit);
+        return 1;
+    }
+
     return 0;
 }
 
+/* Datagram over rate of its client is dropped before it is queued, so it costs no event nor network buffer */
+static bool admit(const struct freertos_sockaddr *from)
+{
+    /* Tick rate divides 1000 Hz, so milliseconds wrap together with ticks */
+    return rate_limit.allow(from->sin_addr, osKernelGetTickCount() * (1000 / osKernelGetTickFreq()));
+}
+
+/* Callback of each port knows its index, so it marks the port without looking the socket up */
+template<size_t port>
+static BaseType_t socket_udp_receive_callback(Socket_t socket, void * data, size_t length, const struct freertos_sockaddr * from, const struct freertos_sockaddr * dest)
+{
+    if (!admit(from))
+        return 1;
+
+    /* Fast path of command port, datagram is consumed here and released by IP stack */
+    if (config::udp_ports[port].service == config::udp_service::command &&
+        respond_inline(socket, { static_cast<const char*>(data), length }, from))
+        return 1;
+
+    return notify_rx(port);
+}
+
+template<size_t... ports>
+static constexpr std::array<FOnUDPReceive_t, sizeof...(ports)> make_receive_callbacks(std::index_sequence<ports...>)
+{
+    return { socket_udp_receive_callback<ports>... };
+}
+
+static constexpr auto receive_callbacks = make_receive_callbacks(std::make_index_sequence<std::size(config::udp_ports)>());
+
 static void socket_udp_sent_callback(Socket_t socket, size_t length)
 {
 
@@ -79,31 +214,58 @@ static void socket_udp_sent_callback(Socket_t socket, size_t length)
 void server::dispatch(const event& e)
 {
     std::visit([this](auto &&e) { this->event_handler(e); }, e.data);
+
+    /* Under steady load queue never empties, so age of batches is checked after each event */
+    if (config::coalesce_responses)
+        this->flush_expired();
+}
+
+void server::dispatch_idle()
+{
+    /* Nothing more to pack, waiting would only add latency */
+    for (auto &batch : this->batches)
+    {
+        if (batch.payload.valid())
+            this->flush(batch);
+    }
 }
 
 void server::event_handler(const events::network_up &e)
 {
     printf("Connected to network\n");
+
+    /* Sockets stay open while network is down */
+    if (this->sockets[0] != nullptr)
+        return;
+
     printf("Starting UDP server...\n");
 
-    /* Open the UDP socket */
-    this->listening_socket = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP);
-    assert(this->listening_socket != FREERTOS_INVALID_SOCKET);
+    for (size_t i = 0; i < std::size(config::udp_ports); i++)
+    {
+        const auto &port = config::udp_ports[i];
 
-    /* Set UDP callbacks */
-    F_TCP_UDP_Handler_t callbacks { nullptr, nullptr, nullptr, socket_udp_receive_callback, socket_udp_sent_callback };
-    FreeRTOS_setsockopt(this->listening_socket, 0, FREERTOS_SO_UDP_RECV_HANDLER, &callbacks, sizeof(callbacks));
-    FreeRTOS_setsockopt(this->listening_socket, 0, FREERTOS_SO_UDP_SENT_HANDLER, &callbacks, sizeof(callbacks));
+        /* Open the UDP socket */
+        Socket_t socket = FreeRTOS_socket(FREERTOS_AF_INET, FREERTOS_SOCK_DGRAM, FREERTOS_IPPROTO_UDP);
+        assert(socket != FREERTOS_INVALID_SOCKET);
 
-    /* Set the socket send timeout */
-    const uint32_t socket_send_timeout = 1000;
-    FreeRTOS_setsockopt(this->listening_socket, 0, FREERTOS_SO_SNDTIMEO, &socket_send_timeout, sizeof(socket_send_timeout));
+        /* Set UDP callbacks, only command port has inline fast path */
+        F_TCP_UDP_Handler_t callbacks { nullptr, nullptr, nullptr, receive_callbacks[i], socket_udp_sent_callback };
+        FreeRTOS_setsockopt(socket, 0, FREERTOS_SO_UDP_RECV_HANDLER, &callbacks, sizeof(callbacks));
+        FreeRTOS_setsockopt(socket, 0, FREERTOS_SO_UDP_SENT_HANDLER, &callbacks, sizeof(callbacks));
 
-    /* Bind to port 7 */
-    this->bind_addr.sin_port = FreeRTOS_htons(7);
-    const bool err = FreeRTOS_bind(this->listening_socket, &this->bind_addr, sizeof(this->bind_addr)) != 0;
+        /* Set the socket send timeout */
+        const uint32_t socket_send_timeout = 1000;
+        FreeRTOS_setsockopt(socket, 0, FREERTOS_SO_SNDTIMEO, &socket_send_timeout, sizeof(socket_send_timeout));
 
-    printf("UDP server %s\n", err ? "start error" : "started");
+        /* Bind to the port of service */
+        freertos_sockaddr bind_addr {};
+        bind_addr.sin_port = FreeRTOS_htons(port.number);
+        const bool err = FreeRTOS_bind(socket, &bind_addr, sizeof(bind_addr)) != 0;
+
+        this->sockets[i] = socket;
+
+        printf("UDP port %u %s\n", port.number, err ? "start error" : "started");
+    }
 }
 
 void server::event_handler(const events::network_down &e)
@@ -118,48 +280,236 @@ void server::event_handler(const events::ip_addr_assigned &e)
     printf("IP address: %s\n", buf);
 }
 
-void server::event_handler(const events::udp_data_received &e)
+server::rx_result server::receive(size_t port)
 {
-    uint32_t client_len = sizeof(this->client_addr);
-    controller_events::command_request cmd_req;
+    Socket_t socket = this->sockets[port];
+    freertos_sockaddr client {};
+    udp_payload request;
 
-    const int32_t result = FreeRTOS_recvfrom(this->listening_socket,
-                                             cmd_req.data,
-                                             sizeof(cmd_req.data),
-                                             FREERTOS_MSG_DONTWAIT,
-                                             &this->client_addr,
-                                             &client_len);
+    /* Get payload in network buffer, it is handed over to controller without copying.
+     * Datagram is left in the socket when application holds too many buffers. */
+    const int32_t result = udp_payload::receive(socket, request, client);
 
-    if (result > 0)
+    if (result == -pdFREERTOS_ERRNO_ENOBUFS)
+        return rx_result::no_buffer;
+
+    if (result < 0)
     {
-        cmd_req.data_size = result;
-        cmd_req.data[cmd_req.data_size] = 0;
-        controller::instance->send({ cmd_req });
+        if (result != -pdFREERTOS_ERRNO_EWOULDBLOCK)
+            printf("Server error: 'recvfrom' failed\n");
+
+        return rx_result::empty;
     }
-    else
+
+    auto &counters = port_counters[port];
+    counters.received.fetch_add(1, std::memory_order_relaxed);
+
+    if (config::udp_ports[port].service == config::udp_service::discovery)
+    {
+        /* Request buffer is released before the response is allocated */
+        request = udp_payload {};
+        this->respond_discovery(socket, client);
+    }
+    else if (result > 0)
     {
-        printf("Server error: 'recvfrom' failed\n");
+        /* Controller shares thread with server, so it can't make space in its queue now.
+         * Request is dropped under overload (counted in controller send statistics), with its buffer. */
+        if (!controller::instance->try_send({ controller_events::command_request { std::move(request), client, socket } }))
+            counters.dropped.fetch_add(1, std::memory_order_relaxed);
     }
+
+    /* Empty datagram is released with the handle */
+    return rx_result::received;
 }
 
-void server::event_handler(const events::command_response &e)
+void server::respond_discovery(Socket_t socket, const freertos_sockaddr &client)
 {
-    const int32_t result = FreeRTOS_sendto(this->listening_socket,
-                                           e.data,
-                                           e.data_size,
-                                           0,
-                                           &this->client_addr,
-                                           sizeof(this->client_addr));
+    udp_payload rsp = udp_payload::allocate();
+    if (!rsp.valid())
+        return;
+
+    char ip[16] {};
+    FreeRTOS_inet_ntoa(FreeRTOS_GetIPAddress(), ip);
+
+    const int rsp_size = std::snprintf(rsp.data(), rsp.size(), ">%s %s\n", pcApplicationHostnameHook(), ip);
+    rsp.resize(std::min<size_t>(rsp_size, rsp.size()));
+
+    if (FreeRTOS_sendto(socket, rsp.data(), rsp.size(), FREERTOS_ZERO_COPY, &client, sizeof(client)) == static_cast<int32_t>(rsp.size()))
+        rsp.hand_over();
+}
 
-    if (result != static_cast<int32_t>(e.data_size) || result < 0)
+void server::event_handler(const events::udp_data_received &e)
+{
+    while (true)
+    {
+        /* Take marked ports and re-arm notification at once, so datagram arriving meanwhile is not missed.
+         * Only marked sockets are read, without blocking, so the wakeup makes no call to IP task. */
+        const uint32_t ports = rx_pending_ports.exchange(0);
+        if (ports == 0)
+        {
+            rx_per_wakeup[0].fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        uint32_t unfinished = 0;
+        bool no_buffer = false;
+
+        /* Each marked port gets the same budget, so busy port can't starve the others */
+        for (size_t i = 0; i < std::size(this->sockets); i++)
+        {
+            if ((ports & (1ul << i)) == 0)
+                continue;
+
+            /* Datagrams stay in sockets until request buffers are released */
+            if (no_buffer)
+            {
+                unfinished |= 1ul << i;
+                continue;
+            }
+
+            size_t received = 0;
+            rx_result result = rx_result::received;
+            while (received < rx_budget && (result = this->receive(i)) == rx_result::received)
+                received++;
+
+            rx_per_wakeup[received].fetch_add(1, std::memory_order_relaxed);
+
+            if (result == rx_result::no_buffer)
+            {
+                no_buffer = true;
+                unfinished |= 1ul << i;
+            }
+            else if (received == rx_budget)
+            {
+                port_counters[i].budget_used.fetch_add(1, std::memory_order_relaxed);
+                unfinished |= 1ul << i;
+            }
+        }
+
+        if (unfinished == 0)
+            return;
+
+        /* Requests are held by controller, which has lower priority and wouldn't run while server posts to itself.
+         * Ports stay marked, so receive callbacks don't post either, until controller resumes draining. */
+        if (no_buffer || udp_payload::rx_in_use() > 0)
+        {
+            rx_waiting.store(true, std::memory_order_relaxed);
+            rx_pending_ports.fetch_or(unfinished);
+            return;
+        }
+
+        /* Ports may have more data, let other events of server run and continue in next wakeup.
+         * Notification is not posted if receive callback has already done it. */
+        if (rx_pending_ports.fetch_or(unfinished) != 0 || post_rx_notification())
+            return;
+
+        /* Own queue is full, so continue now with marked ports, datagrams would be stuck until the next one arrives */
+    }
+}
+
+void server::send_response(udp_payload payload, const freertos_sockaddr &client, Socket_t socket)
+{
+    const int32_t result = FreeRTOS_sendto(socket,
+                                           payload.data(),
+                                           payload.size(),
+                                           FREERTOS_ZERO_COPY,
+                                           &client,
+                                           sizeof(client));
+
+    /* Buffer belongs to IP stack only if it was accepted, otherwise it is released with the handle */
+    if (result == static_cast<int32_t>(payload.size()))
+        payload.hand_over();
+    else
         printf("Server error: 'sendto' failed\n");
 }
 
+void server::coalesce(udp_payload payload, const freertos_sockaddr &client, Socket_t socket)
+{
+    const uint32_t now = drivers::core::get_cycles_counter();
+    pending_batch *slot = nullptr;
+
+    coalesce_counters.responses.fetch_add(1, std::memory_order_relaxed);
+
+    for (auto &batch : this->batches)
+    {
+        if (!batch.payload.valid() || !same_client(batch, client, socket))
+            continue;
+
+        const size_t length = batch.payload.size();
+
+        /* Response is copied into the batch, so its own buffer goes back to IP stack on return */
+        if (length + payload.size() <= batch.payload.max_length())
+        {
+            batch.payload.resize(length + payload.size());
+            std::memcpy(batch.payload.data() + length, payload.data(), payload.size());
+            return;
+        }
+
+        coalesce_counters.full.fetch_add(1, std::memory_order_relaxed);
+        slot = &batch;
+        break;
+    }
+
+    /* Free slot is preferred, otherwise the one with the oldest batch */
+    if (slot == nullptr)
+    {
+        slot = &this->batches[0];
+
+        for (auto &batch : this->batches)
+        {
+            if (!batch.payload.valid())
+            {
+                slot = &batch;
+                break;
+            }
+
+            if (now - batch.started > now - slot->started)
+                slot = &batch;
+        }
+    }
+
+    if (slot->payload.valid())
+        this->flush(*slot);
+
+    /* Buffer of the first response is allocated for the whole datagram, the batch is built in it */
+    *slot = { std::move(payload), client, socket, now };
+}
+
+void server::flush(pending_batch &batch)
+{
+    this->send_response(std::move(batch.payload), batch.client, batch.socket);
+    coalesce_counters.datagrams.fetch_add(1, std::memory_order_relaxed);
+}
+
+void server::flush_expired(void)
+{
+    const uint32_t budget = config::coalesce_budget_us * (drivers::core::get_cycles_frequency() / 1000000);
+    const uint32_t now = drivers::core::get_cycles_counter();
+
+    for (auto &batch : this->batches)
+    {
+        if (batch.payload.valid() && now - batch.started >= budget)
+        {
+            coalesce_counters.expired.fetch_add(1, std::memory_order_relaxed);
+            this->flush(batch);
+        }
+    }
+}
+
+void server::event_handler(const events::command_response &e)
+{
+    if (config::coalesce_responses)
+        this->coalesce(std::move(e.payload), e.client, e.socket);
+    else
+        this->send_response(std::move(e.payload), e.client, e.socket);
+}
+
 //-----------------------------------------------------------------------------
 /* public */
 
-server::server() : active_object("server", osPriorityNormal, 2048),
-listening_socket {nullptr}, client_addr {0}, bind_addr {0}
+server::server(middlewares::cooperative_kernel &kernel, uint8_t priority) :
+static_active_object("server", kernel, priority),
+sockets {}, batches {}
 {
     hal::random::enable(true);
     FreeRTOS_IPInit(config::ip_addr, config::net_mask, config::gateway_addr, config::dns_addr, config::mac_addr);
@@ -174,4 +524,58 @@ server::~server()
 
 }
 
+server::rate_limit_statistics server::get_rate_limit_statistics(void)
+{
+    const auto stats = rate_limit.get_statistics();
+    return { stats.allowed, stats.dropped, stats.evicted, stats.rejected };
+}
+
+server::coalesce_statistics server::get_coalesce_statistics(void)
+{
+    return { coalesce_counters.responses.load(std::memory_order_relaxed),
+             coalesce_counters.datagrams.load(std::memory_order_relaxed),
+             coalesce_counters.full.load(std::memory_order_relaxed),
+             coalesce_counters.expired.load(std::memory_order_relaxed) };
+}
+
+void server::resume_rx(void)
+{
+    if (!rx_waiting.exchange(false, std::memory_order_relaxed))
+        return;
+
+    /* Own queue is full, forget marked ports, so the next datagram posts notification again */
+    if (!post_rx_notification())
+        rx_pending_ports.store(0);
+}
+
+server::inline_statistics server::get_inline_statistics(void)
+{
+    return { inline_responses.load(std::memory_order_relaxed), inline_failures.load(std::memory_order_relaxed) };
+}
+
+server::ports_statistics server::get_port_statistics(void)
+{
+    ports_statistics stats;
+
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        stats[i] = { config::udp_ports[i].number,
+                     port_counters[i].received.load(std::memory_order_relaxed),
+                     port_counters[i].dropped.load(std::memory_order_relaxed),
+                     port_counters[i].budget_used.load(std::memory_order_relaxed) };
+    }
+
+    return stats;
+}
+
+server::rx_statistics server::get_rx_statistics(void)
+{
+    rx_statistics stats;
+
+    for (size_t i = 0; i < stats.size(); i++)
+        stats[i] = rx_per_wakeup[i].load(std::memory_order_relaxed);
+
+    return stats;
+}
+
 
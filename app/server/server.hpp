@@ -8,27 +8,34 @@
 #ifndef SERVER_SERVER_HPP_
 #define SERVER_SERVER_HPP_
 
+#include <array>
+#include <iterator>
 #include <variant>
 
-#include <middlewares/active_object.hpp>
+#include <middlewares/static_active_object.hpp>
+
+#include <app/server/udp_payload.hpp>
+#include <app/config.hpp>
 
 #include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
 
 namespace server_events
 {
 
 struct network_up
 {
-
+    static constexpr auto lane = middlewares::event_lane::high;
 };
 
 struct network_down
 {
-
+    static constexpr auto lane = middlewares::event_lane::high;
 };
 
 struct ip_addr_assigned
 {
+    static constexpr auto lane = middlewares::event_lane::high;
     uint32_t address;
 };
 
@@ -37,10 +44,13 @@ struct udp_data_received
 
 };
 
+/* Formatted in network buffer, which is handed over to IP stack by zero-copy send.
+ * It is sent from the socket which received the request. */
 struct command_response
 {
-    char data[64];
-    size_t data_size;
+    mutable udp_payload payload;    /* Handler moves it out of the event it gets as const */
+    freertos_sockaddr client;
+    Socket_t socket;
 };
 
 using incoming = std::variant
@@ -52,16 +62,90 @@ using incoming = std::variant
     command_response
 >;
 
+/* Payloads are passed by handle, so events stay small whatever the datagram size */
+static_assert(sizeof(incoming) <= 8 * sizeof(void*));
+
 }
 
-class server : public middlewares::active_object<server_events::incoming>
+class server : public middlewares::static_active_object<server_events::incoming, 0, 32, 8, middlewares::notify_transport<32>>
 {
 public:
-    server();
+    server(middlewares::cooperative_kernel &kernel, uint8_t priority);
     ~server();
 
+    /* Datagrams received from one socket in one wakeup at most, then other sockets and events get their turn.
+     * Request buffers run out before a larger budget could be used. */
+    static constexpr size_t rx_budget = udp_payload::max_rx_held;
+
+    /* Histogram of datagrams received from ready socket per wakeup, element [i] counts sockets which gave i datagrams,
+     * the last one counts sockets which used up the budget. Element [0] counts wakeups with no socket ready. */
+    using rx_statistics = std::array<uint32_t, rx_budget + 1>;
+    static rx_statistics get_rx_statistics(void);
+
+    struct port_statistics
+    {
+        uint16_t port;
+        uint32_t received;
+        uint32_t dropped;
+        uint32_t budget_used;
+    };
+
+    /* Counters of each port in config::udp_ports */
+    using ports_statistics = std::array<port_statistics, std::size(config::udp_ports)>;
+    static ports_statistics get_port_statistics(void);
+
+    struct rate_limit_statistics
+    {
+        uint32_t allowed;
+        uint32_t dropped;   /* Datagrams over rate of their client */
+        uint32_t evicted;   /* Clients forgotten to make space for new ones */
+        uint32_t rejected;  /* Datagrams of new clients, no client could be forgotten yet */
+    };
+
+    static rate_limit_statistics get_rate_limit_statistics(void);
+
+    /* Requests answered directly in IP task, they are not counted in rx statistics */
+    struct inline_statistics
+    {
+        uint32_t answered;
+        uint32_t failed;    /* Response was formatted, but 'sendto' did not accept it */
+    };
+
+    static inline_statistics get_inline_statistics(void);
+
+    struct coalesce_statistics
+    {
+        uint32_t responses;     /* Responses packed into batches */
+        uint32_t datagrams;     /* Batches sent */
+        uint32_t full;          /* Batches sent because the next response didn't fit */
+        uint32_t expired;       /* Batches sent because they waited longer than the budget */
+    };
+
+    static coalesce_statistics get_coalesce_statistics(void);
+
+    /* Called by holder of requests (controller) when it has released them, so server continues draining
+     * sockets it left for lack of request buffers. Call it from the thread of server. */
+    static void resume_rx(void);
+
 private:
+    enum class rx_result
+    {
+        received,
+        empty,
+        no_buffer   /* Datagram was left in socket, too many request buffers are held */
+    };
+
+    /* Responses to one client waiting to be sent in one datagram, the first response buffer holds them all */
+    struct pending_batch
+    {
+        udp_payload payload;
+        freertos_sockaddr client;
+        Socket_t socket;
+        uint32_t started;   /* Cycle counter when the first response was added */
+    };
+
     void dispatch(const event &e) override;
+    void dispatch_idle() override;
 
     /* Event handlers */
     void event_handler(const server_events::network_up &e);
@@ -70,8 +154,16 @@ private:
     void event_handler(const server_events::udp_data_received &e);
     void event_handler(const server_events::command_response &e);
 
-    Socket_t listening_socket;
-    struct freertos_sockaddr client_addr, bind_addr;
+    rx_result receive(size_t port);
+    void respond_discovery(Socket_t socket, const freertos_sockaddr &client);
+
+    void send_response(udp_payload payload, const freertos_sockaddr &client, Socket_t socket);
+    void coalesce(udp_payload payload, const freertos_sockaddr &client, Socket_t socket);
+    void flush(pending_batch &batch);
+    void flush_expired(void);
+
+    Socket_t sockets[std::size(config::udp_ports)];
+    pending_batch batches[config::coalesced_clients];
 };
 
 #endif /* SERVER_SERVER_HPP_ */
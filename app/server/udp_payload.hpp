@@ -0,0 +1,194 @@
+/*
+ * udp_payload.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef SERVER_UDP_PAYLOAD_HPP_
+#define SERVER_UDP_PAYLOAD_HPP_
+
+#include "FreeRTOS_IP.h"
+#include "FreeRTOS_Sockets.h"
+
+#include <string_view>
+#include <utility>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+/*
+ * Payload of datagram in network buffer descriptor, received or sent with zero-copy.
+ * Handle is move-only and owns the buffer, which is released when handle is destroyed,
+ * unless it was handed over to IP stack. Event which is dropped before it is handled
+ * releases its payload as well, so buffer can't leak.
+ */
+class udp_payload
+{
+public:
+    /* Network buffers held by application at once, the rest is left for IP stack.
+     * Of 20 buffers, 6 are taken by Ethernet DMA descriptors. Each held request may get a response buffer,
+     * next to the ones of coalesced batches, discovery response and request answered in IP task (see server). */
+    static constexpr size_t max_rx_held = 4;
+    static constexpr size_t max_tx_held = 8;
+
+    /* Largest payload of unfragmented datagram */
+    static constexpr size_t max_size = ipconfigNETWORK_MTU - ipSIZE_OF_IPv4_HEADER - ipSIZE_OF_UDP_HEADER;
+
+    udp_payload() : ptr {nullptr}, length {0}, capacity {0}, tx {false} {}
+
+    udp_payload(udp_payload &&other) : ptr {other.ptr}, length {other.length}, capacity {other.capacity}, tx {other.tx}
+    {
+        other.ptr = nullptr;
+        other.length = 0;
+        other.capacity = 0;
+    }
+
+    udp_payload &operator=(udp_payload &&other)
+    {
+        if (this != &other)
+        {
+            this->release();
+            std::swap(this->ptr, other.ptr);
+            std::swap(this->length, other.length);
+            std::swap(this->capacity, other.capacity);
+            std::swap(this->tx, other.tx);
+        }
+
+        return *this;
+    }
+
+    udp_payload(const udp_payload&) = delete;
+    udp_payload &operator=(const udp_payload&) = delete;
+
+    ~udp_payload()
+    {
+        this->release();
+    }
+
+    /* Receives datagram with zero-copy without blocking, payload is owned by handle (also of empty datagram).
+     * Slot is reserved before the datagram is taken out of the socket, so when too many buffers are held
+     * -pdFREERTOS_ERRNO_ENOBUFS is returned and datagram stays queued. Otherwise result of 'recvfrom'. */
+    static int32_t receive(Socket_t socket, udp_payload &payload, freertos_sockaddr &from)
+    {
+        if (!reserve(rx_held, max_rx_held))
+            return -pdFREERTOS_ERRNO_ENOBUFS;
+
+        char *data = nullptr;
+        uint32_t from_len = sizeof(from);
+        const int32_t result = FreeRTOS_recvfrom(socket, &data, 0, FREERTOS_ZERO_COPY | FREERTOS_MSG_DONTWAIT,
+                                                 &from, &from_len);
+        if (data == nullptr)
+        {
+            rx_held.fetch_sub(1, std::memory_order_relaxed);
+            return result;
+        }
+
+        payload = udp_payload { data, result > 0 ? static_cast<size_t>(result) : 0, false };
+        return result;
+    }
+
+    /* Gets payload buffer for zero-copy send without blocking, empty handle is returned if none is available */
+    static udp_payload allocate(size_t size = max_size)
+    {
+        if (!reserve(tx_held, max_tx_held))
+            return {};
+
+        char *data = static_cast<char*>(FreeRTOS_GetUDPPayloadBuffer(size, 0));
+        if (data == nullptr)
+        {
+            tx_held.fetch_sub(1, std::memory_order_relaxed);
+            return {};
+        }
+
+        return { data, size, true };
+    }
+
+    /* Received payloads which are still held, e.g. queued requests */
+    static size_t rx_in_use()
+    {
+        return rx_held.load(std::memory_order_relaxed);
+    }
+
+    bool valid() const
+    {
+        return this->ptr != nullptr;
+    }
+
+    char *data() const
+    {
+        return this->ptr;
+    }
+
+    size_t size() const
+    {
+        return this->length;
+    }
+
+    size_t max_length() const
+    {
+        return this->capacity;
+    }
+
+    std::string_view view() const
+    {
+        return { this->ptr, this->length };
+    }
+
+    /* Length of data, e.g. of formatted response, can't exceed size of the buffer */
+    void resize(size_t size)
+    {
+        assert(size <= this->capacity);
+        this->length = size;
+    }
+
+    /* Buffer was accepted by zero-copy send, IP stack frees it after transmission.
+     * It is the only way to give up ownership, otherwise buffer is released with the handle. */
+    void hand_over()
+    {
+        if (this->ptr == nullptr)
+            return;
+
+        this->forget();
+    }
+
+private:
+    void release()
+    {
+        if (this->ptr == nullptr)
+            return;
+
+        FreeRTOS_ReleaseUDPPayloadBuffer(this->ptr);
+        this->forget();
+    }
+
+    udp_payload(char *data, size_t size, bool tx) : ptr {data}, length {size}, capacity {size}, tx {tx} {}
+
+    static bool reserve(std::atomic<size_t> &held, size_t max)
+    {
+        if (held.fetch_add(1, std::memory_order_relaxed) < max)
+            return true;
+
+        held.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void forget()
+    {
+        (this->tx ? tx_held : rx_held).fetch_sub(1, std::memory_order_relaxed);
+        this->ptr = nullptr;
+        this->length = 0;
+        this->capacity = 0;
+    }
+
+    static inline std::atomic<size_t> rx_held {0};
+    static inline std::atomic<size_t> tx_held {0};
+
+    char *ptr;
+    size_t length;
+    size_t capacity;
+    bool tx;
+};
+
+#endif /* SERVER_UDP_PAYLOAD_HPP_ */
@@ -25,6 +25,11 @@ uint32_t core::get_cycles_counter(void)
     return DWT->CYCCNT;
 }
 
+uint32_t core::get_cycles_frequency(void)
+{
+    return SystemCoreClock;
+}
+
 core_critical_section::core_critical_section(void)
 {
     this->primask = __get_PRIMASK();
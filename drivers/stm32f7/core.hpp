@@ -20,6 +20,7 @@ public:
 
     static void enable_cycles_counter(void);
     static uint32_t get_cycles_counter(void);
+    static uint32_t get_cycles_frequency(void);
 };
 
 class core_critical_section
@@ -0,0 +1,616 @@
+/*
+ * active_object_bench.cpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+/* Host benchmark of active object mailbox: throughput, send to dispatch latency
+ * and heap allocations per event, then latency of command answered inline compared
+ * to the path through server and controller. Latency is measured with steady clock. */
+
+#include <middlewares/active_object.hpp>
+
+#include <app/controller/command.hpp>
+#include <app/controller/binary_command.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace
+{
+
+std::atomic<uint32_t> allocations {0};
+
+uint32_t now_ns()
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+}
+
+/* Count every heap allocation made by the process */
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace bench_events
+{
+
+struct request
+{
+    uint32_t sent_at;
+    uint32_t seq;
+    char payload[64];
+};
+
+struct response
+{
+    uint32_t sent_at;
+    uint32_t size;
+    char payload[64];
+};
+
+struct control
+{
+    static constexpr auto lane = middlewares::event_lane::high;
+};
+
+using incoming = std::variant<request, response, control>;
+
+}
+
+namespace
+{
+
+struct result
+{
+    const char *name;
+    uint32_t events;
+    uint32_t delivered;
+    double seconds;
+    uint32_t p50, p99, p999;
+    uint32_t allocations;
+};
+
+template<size_t pool_size, size_t max_batch, typename transport = middlewares::os_queue_transport>
+class sink : public middlewares::active_object<bench_events::incoming, pool_size, max_batch, transport>
+{
+    using base = middlewares::active_object<bench_events::incoming, pool_size, max_batch, transport>;
+
+public:
+    explicit sink(uint32_t events) : base {"sink", osPriorityNormal, 0, 32}
+    {
+        this->samples.reserve(events);
+    }
+
+    sink(uint32_t events, middlewares::cooperative_kernel &kernel, uint8_t priority) : base {"sink", kernel, priority, 32}
+    {
+        this->samples.reserve(events);
+    }
+
+    uint32_t received() const
+    {
+        return this->count.load(std::memory_order_acquire);
+    }
+
+    std::vector<uint32_t> &latencies()
+    {
+        return this->samples;
+    }
+
+private:
+    void dispatch(const typename base::event &e) override
+    {
+        if (auto *req = std::get_if<bench_events::request>(&e.data))
+            this->samples.push_back(now_ns() - req->sent_at);
+
+        this->count.fetch_add(1, std::memory_order_release);
+    }
+
+    std::vector<uint32_t> samples;
+    std::atomic<uint32_t> count {0};
+};
+
+/* First stage of pipeline, passes requests to the sink like server passes them to controller */
+template<typename Next>
+class forwarder : public middlewares::active_object<bench_events::incoming, 64, 8>
+{
+    using base = middlewares::active_object<bench_events::incoming, 64, 8>;
+
+public:
+    explicit forwarder(Next &next) : base {"forwarder", osPriorityNormal, 0, 32}, next {next}
+    {
+
+    }
+
+    forwarder(Next &next, middlewares::cooperative_kernel &kernel, uint8_t priority) :
+        base {"forwarder", kernel, priority, 32}, next {next}
+    {
+
+    }
+
+private:
+    void dispatch(const event &e) override
+    {
+        this->next.send({ e.data });
+    }
+
+    Next &next;
+};
+
+/* Stand-ins of server and controller in shared kernel, request goes server -> controller -> server.
+ * Base types differ in pool size, since each active object type is unique. */
+using server_stage = middlewares::active_object<bench_events::incoming, 64, 8, middlewares::notify_transport<32>>;
+using controller_stage = middlewares::active_object<bench_events::incoming, 32, 8, middlewares::notify_transport<32>>;
+
+class bench_server : public server_stage
+{
+public:
+    bench_server(uint32_t events, middlewares::cooperative_kernel &kernel, uint8_t priority) :
+        server_stage {"server", kernel, priority, 32}
+    {
+        this->samples.reserve(events);
+    }
+
+    void set_controller(controller_stage &ctrl)
+    {
+        this->ctrl = &ctrl;
+    }
+
+    uint32_t received() const
+    {
+        return this->count.load(std::memory_order_acquire);
+    }
+
+    std::vector<uint32_t> &latencies()
+    {
+        return this->samples;
+    }
+
+private:
+    void dispatch(const event &e) override
+    {
+        if (auto *req = std::get_if<bench_events::request>(&e.data))
+        {
+            this->ctrl->try_send({ *req });
+        }
+        else if (auto *rsp = std::get_if<bench_events::response>(&e.data))
+        {
+            /* Response would be sent here */
+            this->samples.push_back(now_ns() - rsp->sent_at);
+            this->count.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    controller_stage *ctrl = nullptr;
+    std::vector<uint32_t> samples;
+    std::atomic<uint32_t> count {0};
+};
+
+class bench_controller : public controller_stage
+{
+public:
+    bench_controller(server_stage &srv, middlewares::cooperative_kernel &kernel, uint8_t priority) :
+        controller_stage {"controller", kernel, priority, 32}, srv {srv}
+    {
+
+    }
+
+private:
+    void dispatch(const event &e) override
+    {
+        auto *req = std::get_if<bench_events::request>(&e.data);
+        if (req == nullptr)
+            return;
+
+        bench_events::response rsp { req->sent_at, 0, {} };
+        command::text cmd;
+
+        if (command::parse(req->payload, cmd))
+        {
+            if (auto *handler = command::find_inline(cmd))
+                rsp.size = handler->respond(handler->ctx, rsp.payload, sizeof(rsp.payload));
+        }
+
+        this->srv.try_send({ rsp });
+    }
+
+    server_stage &srv;
+};
+
+uint32_t percentile(const std::vector<uint32_t> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+
+    return sorted[static_cast<size_t>(p * (sorted.size() - 1))];
+}
+
+/* Producer posts 'events' requests from main thread, with blocking send or try_send */
+template<size_t pool_size, size_t max_batch, typename transport = middlewares::os_queue_transport>
+result run(const char *name, uint32_t events, bool blocking)
+{
+    sink<pool_size, max_batch, transport> consumer {events};
+    bench_events::request req {};
+    uint32_t accepted = 0;
+
+    const uint32_t allocations_start = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < events; i++)
+    {
+        req.seq = i;
+        req.sent_at = now_ns();
+
+        if (blocking)
+        {
+            consumer.send({ req });
+            accepted++;
+        }
+        else if (consumer.try_send({ req }))
+        {
+            accepted++;
+        }
+    }
+
+    while (consumer.received() < accepted)
+        std::this_thread::yield();
+
+    const auto stop = std::chrono::steady_clock::now();
+    const uint32_t allocations_used = allocations.load() - allocations_start;
+
+    auto &samples = consumer.latencies();
+    std::sort(samples.begin(), samples.end());
+
+    return { name, events, accepted, std::chrono::duration<double>(stop - start).count(),
+             percentile(samples, 0.5), percentile(samples, 0.99), percentile(samples, 0.999),
+             allocations_used };
+}
+
+/* Producer posts requests through two active objects, each with own thread or sharing kernel */
+result run_pipeline(const char *name, uint32_t events, bool shared)
+{
+    using last_stage = sink<80, 8>;
+
+    std::optional<middlewares::cooperative_kernel> kernel;
+    std::optional<last_stage> consumer;
+    std::optional<forwarder<last_stage>> first;
+
+    if (shared)
+    {
+        /* Sink has higher priority, so forwarder never overflows its queue */
+        kernel.emplace("kernel", osPriorityNormal, 0);
+        consumer.emplace(events, *kernel, 2);
+        first.emplace(*consumer, *kernel, 1);
+    }
+    else
+    {
+        consumer.emplace(events);
+        first.emplace(*consumer);
+    }
+
+    bench_events::request req {};
+
+    const uint32_t allocations_start = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < events; i++)
+    {
+        req.seq = i;
+        req.sent_at = now_ns();
+        first->send({ req });
+    }
+
+    while (consumer->received() < events)
+        std::this_thread::yield();
+
+    const auto stop = std::chrono::steady_clock::now();
+    const uint32_t allocations_used = allocations.load() - allocations_start;
+
+    auto &samples = consumer->latencies();
+    std::sort(samples.begin(), samples.end());
+
+    const result r { name, events, events, std::chrono::duration<double>(stop - start).count(),
+                     percentile(samples, 0.5), percentile(samples, 0.99), percentile(samples, 0.999),
+                     allocations_used };
+
+    /* Active objects are detached before kernel stops */
+    first.reset();
+    consumer.reset();
+    kernel.reset();
+
+    return r;
+}
+
+/* Several producer threads post to one active object without blocking */
+template<typename transport>
+result run_producers(const char *name, uint32_t events, size_t producers)
+{
+    sink<80, 8, transport> consumer {events};
+    const uint32_t per_producer = events / producers;
+    std::vector<std::thread> threads;
+
+    const uint32_t allocations_start = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&consumer, per_producer]()
+        {
+            bench_events::request req {};
+
+            for (uint32_t i = 0; i < per_producer; i++)
+            {
+                req.seq = i;
+                req.sent_at = now_ns();
+
+                /* Non-blocking path used by interrupts and IP task, retried when full */
+                while (!consumer.try_send({ req }))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    /* Threads are allocated before events are counted */
+    const uint32_t allocations_threads = allocations.load() - allocations_start;
+
+    for (auto &t : threads)
+        t.join();
+
+    while (consumer.received() < per_producer * producers)
+        std::this_thread::yield();
+
+    const auto stop = std::chrono::steady_clock::now();
+    const uint32_t allocations_used = allocations.load() - allocations_start - allocations_threads;
+
+    auto &samples = consumer.latencies();
+    std::sort(samples.begin(), samples.end());
+
+    return { name, per_producer * static_cast<uint32_t>(producers), per_producer * static_cast<uint32_t>(producers),
+             std::chrono::duration<double>(stop - start).count(),
+             percentile(samples, 0.5), percentile(samples, 0.99), percentile(samples, 0.999),
+             allocations_used };
+}
+
+int led_state(void *ctx, char *buf, size_t size)
+{
+    return std::snprintf(buf, size, ">led is %s\n", *static_cast<bool*>(ctx) ? "on" : "off");
+}
+
+/* Read-only command answered in the thread which received it, like in IP task callback */
+result run_inline(const char *name, uint32_t events)
+{
+    std::vector<uint32_t> samples;
+    samples.reserve(events);
+
+    const uint32_t allocations_start = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < events; i++)
+    {
+        bench_events::request req { now_ns(), i, "led get\n" };
+        char rsp[64];
+        command::text cmd;
+
+        if (command::parse(req.payload, cmd))
+        {
+            if (auto *handler = command::find_inline(cmd))
+                handler->respond(handler->ctx, rsp, sizeof(rsp));
+        }
+
+        asm volatile("" : : "r"(rsp) : "memory");
+        samples.push_back(now_ns() - req.sent_at);
+    }
+
+    const auto stop = std::chrono::steady_clock::now();
+
+    std::sort(samples.begin(), samples.end());
+
+    return { name, events, events, std::chrono::duration<double>(stop - start).count(),
+             percentile(samples, 0.5), percentile(samples, 0.99), percentile(samples, 0.999),
+             allocations.load() - allocations_start };
+}
+
+/* The same command going through server and controller active objects, caller thread acts as IP task */
+result run_round_trip(const char *name, uint32_t events)
+{
+    std::optional<middlewares::cooperative_kernel> kernel;
+    std::optional<bench_server> srv;
+    std::optional<bench_controller> ctrl;
+
+    /* Priorities like in the application, server is served first */
+    kernel.emplace("kernel", osPriorityNormal, 0);
+    srv.emplace(events, *kernel, 2);
+    ctrl.emplace(*srv, *kernel, 1);
+    srv->set_controller(*ctrl);
+
+    const uint32_t allocations_start = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < events; i++)
+    {
+        bench_events::request req { now_ns(), i, "led get\n" };
+
+        /* One request in flight, so latency is not inflated by queueing */
+        srv->send({ req });
+
+        while (srv->received() <= i)
+            std::this_thread::yield();
+    }
+
+    const auto stop = std::chrono::steady_clock::now();
+    const uint32_t allocations_used = allocations.load() - allocations_start;
+
+    auto &samples = srv->latencies();
+    std::sort(samples.begin(), samples.end());
+
+    const result r { name, events, srv->received(), std::chrono::duration<double>(stop - start).count(),
+                     percentile(samples, 0.5), percentile(samples, 0.99), percentile(samples, 0.999),
+                     allocations_used };
+
+    ctrl.reset();
+    srv.reset();
+    kernel.reset();
+
+    return r;
+}
+
+void print(const result &r)
+{
+    std::printf("%-30s %10.0f %9u %9u %9u %11.3f %9.1f%%\n",
+                r.name, r.delivered / r.seconds, r.p50, r.p99, r.p999,
+                static_cast<double>(r.allocations) / r.events,
+                100.0 * (r.events - r.delivered) / r.events);
+}
+
+void bench_command_parse()
+{
+    constexpr uint32_t iterations = 10000000;
+    const char data[] = "led 1\n";
+    command::text cmd;
+    size_t total = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        std::string_view input { data, sizeof(data) - 1 };
+        asm volatile("" : "+r"(input));
+
+        if (command::parse(input, cmd))
+            total += cmd.arg.size();
+    }
+
+    const auto stop = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+
+    std::printf("\ncommand::parse: %.1f ns/op (%zu)\n", ns / iterations, total / iterations);
+}
+
+/* Batch of commands in one binary request compared to the same commands as text datagrams */
+void bench_binary_decode()
+{
+    constexpr uint32_t iterations = 1000000;
+    constexpr uint16_t batch = 32;
+
+    char request[binary_command::header_size + batch * 3] = { static_cast<char>(binary_command::magic), binary_command::version,
+                                                               batch, 0, 1, 0, 0, 0 };
+    for (size_t i = 0; i < batch; i++)
+    {
+        char *tlv = &request[binary_command::header_size + i * 3];
+        tlv[0] = static_cast<char>(binary_command::type::led_set);
+        tlv[1] = 1;
+        tlv[2] = i & 1;
+    }
+
+    const char text[] = "led on\n";
+    char response[binary_command::header_size + batch * 3];
+    size_t total = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        std::string_view input { request, sizeof(request) };
+        asm volatile("" : "+r"(input));
+
+        binary_command::reader req;
+        binary_command::tlv cmd;
+        req.open(input);
+        binary_command::writer rsp { response, sizeof(response), req.request_id() };
+
+        while (req.next(cmd))
+            rsp.add(cmd.type, binary_command::status::ok);
+
+        total += rsp.finish();
+    }
+
+    const double binary_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        for (size_t j = 0; j < batch; j++)
+        {
+            std::string_view input { text, sizeof(text) - 1 };
+            asm volatile("" : "+r"(input));
+
+            command::text cmd;
+            if (command::parse(input, cmd))
+                total += cmd.arg.size();
+        }
+    }
+
+    const double text_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("binary batch of %u: %.1f ns/command (decode and encode), text: %.1f ns/command (parse only) (%zu)\n",
+                batch, binary_ns / iterations / batch, text_ns / iterations / batch, total / iterations);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    const uint32_t events = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+
+    osKernelInitialize();
+    osKernelStart();
+
+    std::printf("%-30s %10s %9s %9s %9s %11s %10s\n",
+                "scenario", "events/s", "p50 ns", "p99 ns", "p999 ns", "allocs/evt", "dropped");
+
+    print(run<80, 1>("send, batch 1", events, true));
+    print(run<80, 8>("send, batch 8", events, true));
+    print(run<80, 1, middlewares::mpsc_transport<32>>("send mpsc, batch 1", events, true));
+    print(run<80, 8, middlewares::mpsc_transport<32>>("send mpsc, batch 8", events, true));
+    print(run<80, 1, middlewares::notify_transport<32>>("send notify, batch 1", events, true));
+    print(run<80, 8, middlewares::notify_transport<32>>("send notify, batch 8", events, true));
+    print(run<8, 1>("send, pool 8 (heap fallback)", events, true));
+    print(run<80, 1>("try_send overload, batch 1", events, false));
+    print(run<80, 8>("try_send overload, batch 8", events, false));
+    print(run_pipeline("pipeline, thread per object", events, false));
+    print(run_pipeline("pipeline, shared kernel", events, true));
+    print(run_producers<middlewares::os_queue_transport>("4 producers, kernel queue", events, 4));
+    print(run_producers<middlewares::mpsc_transport<32>>("4 producers, mpsc queue", events, 4));
+    print(run_producers<middlewares::notify_transport<32>>("4 producers, notify", events, 4));
+
+
+    static bool led = true;
+    command::register_inline({ "led", "get", led_state, &led });
+
+    std::printf("\nrequest to response latency of 'led get'\n");
+    print(run_inline("inline, in receiving thread", events));
+    print(run_round_trip("server -> controller -> server", events / 10));
+
+    bench_command_parse();
+    bench_binary_decode();
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+/*
+ * transport_bench_main.cpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#include <app/bench/transport_bench.hpp>
+
+#include "cmsis_os2.h"
+
+int main(void)
+{
+    osKernelInitialize();
+    osKernelStart();
+
+    transport_bench::run();
+
+    return 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * core.cpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+/* Host replacement of STM32F7 core driver, cycles counter counts nanoseconds */
+
+#include <drivers/stm32f7/core.hpp>
+
+#include <chrono>
+
+using namespace drivers;
+
+//-----------------------------------------------------------------------------
+/* public */
+
+void core::enable_cycles_counter(void)
+{
+
+}
+
+uint32_t core::get_cycles_counter(void)
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+
+uint32_t core::get_cycles_frequency(void)
+{
+    return 1000000000;
+}
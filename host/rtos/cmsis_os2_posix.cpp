@@ -0,0 +1,586 @@
+/*
+ * cmsis_os2_posix.cpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+/* Subset of CMSIS-RTOS2 API implemented with POSIX threads for host builds.
+ * One kernel tick is one millisecond. There is no preemption by priority,
+ * thread priorities and stack sizes are ignored. */
+
+#include "cmsis_os2.h"
+
+#include <pthread.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstring>
+
+namespace
+{
+
+using clock = std::chrono::steady_clock;
+
+const clock::time_point boot_time = clock::now();
+osKernelState_t kernel_state = osKernelInactive;
+
+/* Blocked threads wake up at least this often to check for termination request */
+constexpr auto termination_poll = std::chrono::milliseconds(10);
+
+struct thread_cb
+{
+    pthread_t handle;
+    osThreadFunc_t func;
+    void *argument;
+    std::string name;
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t flags = 0;
+    std::atomic<bool> terminate {false};
+};
+
+struct semaphore_cb
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t count;
+    uint32_t max_count;
+};
+
+struct queue_cb
+{
+    std::mutex mutex;
+    std::condition_variable not_empty, not_full;
+    std::vector<uint8_t> buffer;
+    uint32_t msg_size;
+    uint32_t capacity;
+    uint32_t head = 0;
+    uint32_t count = 0;
+};
+
+struct timer_cb
+{
+    osTimerFunc_t func;
+    void *argument;
+    osTimerType_t type;
+    std::mutex mutex;
+    std::condition_variable cv;
+    clock::duration period {};
+    clock::time_point deadline {};
+    bool running = false;
+    bool exit = false;
+    std::thread worker;
+};
+
+thread_local thread_cb *current_thread = nullptr;
+
+std::mutex kernel_mutex;
+thread_local bool kernel_locked = false;
+
+thread_cb *self()
+{
+    /* Threads not created with osThreadNew (e.g. main) get control block on first use */
+    if (current_thread == nullptr)
+    {
+        current_thread = new thread_cb;
+        current_thread->handle = pthread_self();
+    }
+
+    return current_thread;
+}
+
+void exit_if_terminated()
+{
+    if (current_thread != nullptr && current_thread->terminate.load())
+        pthread_exit(nullptr);
+}
+
+/* Waits until predicate is true or timeout expires, returns the predicate */
+template<typename Pred>
+bool wait(std::unique_lock<std::mutex> &lock, std::condition_variable &cv, uint32_t timeout, Pred pred)
+{
+    const auto deadline = clock::now() + std::chrono::milliseconds(timeout);
+
+    while (!pred())
+    {
+        if (timeout == 0)
+            return false;
+
+        exit_if_terminated();
+
+        const auto now = clock::now();
+        if (timeout != osWaitForever && now >= deadline)
+            return false;
+
+        auto wake_up = now + termination_poll;
+        if (timeout != osWaitForever && deadline < wake_up)
+            wake_up = deadline;
+
+        cv.wait_until(lock, wake_up);
+    }
+
+    return true;
+}
+
+void *thread_entry(void *arg)
+{
+    current_thread = static_cast<thread_cb*>(arg);
+    current_thread->func(current_thread->argument);
+    return nullptr;
+}
+
+void timer_loop(timer_cb *timer)
+{
+    std::unique_lock<std::mutex> lock(timer->mutex);
+
+    while (!timer->exit)
+    {
+        if (!timer->running)
+        {
+            timer->cv.wait(lock);
+            continue;
+        }
+
+        if (timer->cv.wait_until(lock, timer->deadline) != std::cv_status::timeout)
+            continue;
+
+        if (!timer->running || clock::now() < timer->deadline)
+            continue;
+
+        if (timer->type == osTimerPeriodic)
+            timer->deadline += timer->period;
+        else
+            timer->running = false;
+
+        /* Callback may start or stop the timer */
+        lock.unlock();
+        timer->func(timer->argument);
+        lock.lock();
+    }
+}
+
+}
+
+//-----------------------------------------------------------------------------
+/* kernel */
+
+osStatus_t osKernelInitialize(void)
+{
+    kernel_state = osKernelReady;
+    return osOK;
+}
+
+osKernelState_t osKernelGetState(void)
+{
+    return kernel_state;
+}
+
+/* Threads run as soon as they are created, so unlike on target this returns */
+osStatus_t osKernelStart(void)
+{
+    kernel_state = osKernelRunning;
+    return osOK;
+}
+
+/* Kernel lock only excludes other lock holders, it does not stop scheduling */
+int32_t osKernelLock(void)
+{
+    if (kernel_locked)
+        return 1;
+
+    kernel_mutex.lock();
+    kernel_locked = true;
+    return 0;
+}
+
+int32_t osKernelUnlock(void)
+{
+    if (!kernel_locked)
+        return 0;
+
+    kernel_locked = false;
+    kernel_mutex.unlock();
+    return 1;
+}
+
+int32_t osKernelRestoreLock(int32_t lock)
+{
+    if (lock == 0)
+        osKernelUnlock();
+    else
+        osKernelLock();
+
+    return lock;
+}
+
+uint32_t osKernelGetTickCount(void)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - boot_time).count();
+}
+
+uint32_t osKernelGetTickFreq(void)
+{
+    return 1000;
+}
+
+uint32_t osKernelGetSysTimerCount(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - boot_time).count();
+}
+
+uint32_t osKernelGetSysTimerFreq(void)
+{
+    return 1000000000;
+}
+
+//-----------------------------------------------------------------------------
+/* threads */
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr)
+{
+    if (func == nullptr)
+        return nullptr;
+
+    auto *thread = new thread_cb;
+    thread->func = func;
+    thread->argument = argument;
+    if (attr != nullptr && attr->name != nullptr)
+        thread->name = attr->name;
+
+    if (pthread_create(&thread->handle, nullptr, thread_entry, thread) != 0)
+    {
+        delete thread;
+        return nullptr;
+    }
+
+    return thread;
+}
+
+const char *osThreadGetName(osThreadId_t thread_id)
+{
+    return thread_id != nullptr ? static_cast<thread_cb*>(thread_id)->name.c_str() : nullptr;
+}
+
+osThreadId_t osThreadGetId(void)
+{
+    return self();
+}
+
+osStatus_t osThreadYield(void)
+{
+    std::this_thread::yield();
+    return osOK;
+}
+
+osStatus_t osThreadSuspend(osThreadId_t thread_id)
+{
+    if (thread_id != self())
+        return osErrorParameter;
+
+    while (true)
+    {
+        exit_if_terminated();
+        std::this_thread::sleep_for(termination_poll);
+    }
+}
+
+void osThreadExit(void)
+{
+    thread_cb *thread = self();
+    current_thread = nullptr;
+
+    pthread_detach(thread->handle);
+    delete thread;
+    pthread_exit(nullptr);
+}
+
+/* Other thread is terminated when it blocks in one of kernel calls next time */
+osStatus_t osThreadTerminate(osThreadId_t thread_id)
+{
+    auto *thread = static_cast<thread_cb*>(thread_id);
+    if (thread == nullptr)
+        return osErrorParameter;
+
+    thread->terminate.store(true);
+
+    if (thread == current_thread)
+        pthread_exit(nullptr);
+
+    pthread_join(thread->handle, nullptr);
+    delete thread;
+    return osOK;
+}
+
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags)
+{
+    auto *thread = static_cast<thread_cb*>(thread_id);
+    if (thread == nullptr || (flags & osFlagsError) != 0)
+        return osFlagsErrorParameter;
+
+    std::lock_guard<std::mutex> lock(thread->mutex);
+    thread->flags |= flags;
+    thread->cv.notify_one();
+    return thread->flags;
+}
+
+uint32_t osThreadFlagsClear(uint32_t flags)
+{
+    thread_cb *thread = self();
+    std::lock_guard<std::mutex> lock(thread->mutex);
+    const uint32_t previous = thread->flags;
+    thread->flags &= ~flags;
+    return previous;
+}
+
+uint32_t osThreadFlagsGet(void)
+{
+    thread_cb *thread = self();
+    std::lock_guard<std::mutex> lock(thread->mutex);
+    return thread->flags;
+}
+
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout)
+{
+    thread_cb *thread = self();
+    std::unique_lock<std::mutex> lock(thread->mutex);
+
+    auto ready = [&]()
+    {
+        if (options & osFlagsWaitAll)
+            return (thread->flags & flags) == flags;
+        else
+            return (thread->flags & flags) != 0;
+    };
+
+    if (!wait(lock, thread->cv, timeout, ready))
+        return timeout == 0 ? osFlagsErrorResource : osFlagsErrorTimeout;
+
+    const uint32_t result = thread->flags;
+    if (!(options & osFlagsNoClear))
+        thread->flags &= ~flags;
+
+    return result;
+}
+
+osStatus_t osDelay(uint32_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+    return osOK;
+}
+
+//-----------------------------------------------------------------------------
+/* timers */
+
+osTimerId_t osTimerNew(osTimerFunc_t func, osTimerType_t type, void *argument, const osTimerAttr_t *attr)
+{
+    if (func == nullptr)
+        return nullptr;
+
+    auto *timer = new timer_cb;
+    timer->func = func;
+    timer->argument = argument;
+    timer->type = type;
+    timer->worker = std::thread(timer_loop, timer);
+    return timer;
+}
+
+osStatus_t osTimerStart(osTimerId_t timer_id, uint32_t ticks)
+{
+    auto *timer = static_cast<timer_cb*>(timer_id);
+    if (timer == nullptr || ticks == 0)
+        return osErrorParameter;
+
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    timer->period = std::chrono::milliseconds(ticks);
+    timer->deadline = clock::now() + timer->period;
+    timer->running = true;
+    timer->cv.notify_one();
+    return osOK;
+}
+
+osStatus_t osTimerStop(osTimerId_t timer_id)
+{
+    auto *timer = static_cast<timer_cb*>(timer_id);
+    if (timer == nullptr)
+        return osErrorParameter;
+
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    if (!timer->running)
+        return osErrorResource;
+
+    timer->running = false;
+    timer->cv.notify_one();
+    return osOK;
+}
+
+uint32_t osTimerIsRunning(osTimerId_t timer_id)
+{
+    auto *timer = static_cast<timer_cb*>(timer_id);
+    if (timer == nullptr)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(timer->mutex);
+    return timer->running;
+}
+
+osStatus_t osTimerDelete(osTimerId_t timer_id)
+{
+    auto *timer = static_cast<timer_cb*>(timer_id);
+    if (timer == nullptr)
+        return osErrorParameter;
+
+    {
+        std::lock_guard<std::mutex> lock(timer->mutex);
+        timer->exit = true;
+        timer->cv.notify_one();
+    }
+
+    timer->worker.join();
+    delete timer;
+    return osOK;
+}
+
+//-----------------------------------------------------------------------------
+/* semaphores */
+
+osSemaphoreId_t osSemaphoreNew(uint32_t max_count, uint32_t initial_count, const osSemaphoreAttr_t *attr)
+{
+    if (max_count == 0 || initial_count > max_count)
+        return nullptr;
+
+    auto *semaphore = new semaphore_cb;
+    semaphore->count = initial_count;
+    semaphore->max_count = max_count;
+    return semaphore;
+}
+
+osStatus_t osSemaphoreAcquire(osSemaphoreId_t semaphore_id, uint32_t timeout)
+{
+    auto *semaphore = static_cast<semaphore_cb*>(semaphore_id);
+    if (semaphore == nullptr)
+        return osErrorParameter;
+
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    if (!wait(lock, semaphore->cv, timeout, [&]() { return semaphore->count > 0; }))
+        return timeout == 0 ? osErrorResource : osErrorTimeout;
+
+    semaphore->count--;
+    return osOK;
+}
+
+osStatus_t osSemaphoreRelease(osSemaphoreId_t semaphore_id)
+{
+    auto *semaphore = static_cast<semaphore_cb*>(semaphore_id);
+    if (semaphore == nullptr)
+        return osErrorParameter;
+
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->count == semaphore->max_count)
+        return osErrorResource;
+
+    semaphore->count++;
+    semaphore->cv.notify_one();
+    return osOK;
+}
+
+uint32_t osSemaphoreGetCount(osSemaphoreId_t semaphore_id)
+{
+    auto *semaphore = static_cast<semaphore_cb*>(semaphore_id);
+    if (semaphore == nullptr)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    return semaphore->count;
+}
+
+osStatus_t osSemaphoreDelete(osSemaphoreId_t semaphore_id)
+{
+    delete static_cast<semaphore_cb*>(semaphore_id);
+    return osOK;
+}
+
+//-----------------------------------------------------------------------------
+/* message queues */
+
+osMessageQueueId_t osMessageQueueNew(uint32_t msg_count, uint32_t msg_size, const osMessageQueueAttr_t *attr)
+{
+    if (msg_count == 0 || msg_size == 0)
+        return nullptr;
+
+    auto *queue = new queue_cb;
+    queue->buffer.resize(msg_count * msg_size);
+    queue->msg_size = msg_size;
+    queue->capacity = msg_count;
+    return queue;
+}
+
+/* Message priority is ignored, same as in FreeRTOS port */
+osStatus_t osMessageQueuePut(osMessageQueueId_t mq_id, const void *msg_ptr, uint8_t msg_prio, uint32_t timeout)
+{
+    auto *queue = static_cast<queue_cb*>(mq_id);
+    if (queue == nullptr || msg_ptr == nullptr)
+        return osErrorParameter;
+
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!wait(lock, queue->not_full, timeout, [&]() { return queue->count < queue->capacity; }))
+        return timeout == 0 ? osErrorResource : osErrorTimeout;
+
+    const uint32_t tail = (queue->head + queue->count) % queue->capacity;
+    std::memcpy(&queue->buffer[tail * queue->msg_size], msg_ptr, queue->msg_size);
+    queue->count++;
+    queue->not_empty.notify_one();
+    return osOK;
+}
+
+osStatus_t osMessageQueueGet(osMessageQueueId_t mq_id, void *msg_ptr, uint8_t *msg_prio, uint32_t timeout)
+{
+    auto *queue = static_cast<queue_cb*>(mq_id);
+    if (queue == nullptr || msg_ptr == nullptr)
+        return osErrorParameter;
+
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!wait(lock, queue->not_empty, timeout, [&]() { return queue->count > 0; }))
+        return timeout == 0 ? osErrorResource : osErrorTimeout;
+
+    std::memcpy(msg_ptr, &queue->buffer[queue->head * queue->msg_size], queue->msg_size);
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    queue->not_full.notify_one();
+
+    if (msg_prio != nullptr)
+        *msg_prio = 0;
+
+    return osOK;
+}
+
+uint32_t osMessageQueueGetCount(osMessageQueueId_t mq_id)
+{
+    auto *queue = static_cast<queue_cb*>(mq_id);
+    if (queue == nullptr)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->count;
+}
+
+uint32_t osMessageQueueGetSpace(osMessageQueueId_t mq_id)
+{
+    auto *queue = static_cast<queue_cb*>(mq_id);
+    if (queue == nullptr)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->capacity - queue->count;
+}
+
+osStatus_t osMessageQueueDelete(osMessageQueueId_t mq_id)
+{
+    delete static_cast<queue_cb*>(mq_id);
+    return osOK;
+}
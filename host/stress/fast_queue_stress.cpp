@@ -0,0 +1,182 @@
+/*
+ * fast_queue_stress.cpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+/* Producer and consumer threads hammer small queue and verify order and contents of elements.
+ * Built with ThreadSanitizer by 'make stress', which reports any data race in the queue. */
+
+#include <libs/fast_queue.hpp>
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+
+namespace
+{
+
+struct record
+{
+    uint64_t seq;
+    uint64_t check;
+    uint8_t payload[48];
+};
+
+enum class mode
+{
+    single,     /* push / pop */
+    bulk,       /* push_n / pop_n */
+    in_place,   /* reserve / commit and peek / consume */
+};
+
+const char *mode_names[] = { "single", "bulk", "in place" };
+
+void fill(record &r, uint64_t seq)
+{
+    r.seq = seq;
+    r.check = ~seq;
+    r.payload[0] = r.payload[sizeof(r.payload) - 1] = static_cast<uint8_t>(seq);
+}
+
+bool verify(const record &r, uint64_t seq)
+{
+    return r.seq == seq && r.check == ~seq && r.payload[0] == static_cast<uint8_t>(seq)
+           && r.payload[sizeof(r.payload) - 1] == static_cast<uint8_t>(seq);
+}
+
+/* Varies number of elements moved at once between 1 and 7 */
+size_t chunk(uint64_t seq)
+{
+    return 1 + seq % 7;
+}
+
+template<size_t N>
+size_t produce(libs::fast_queue<record, N> &queue, uint64_t seq, uint64_t count, mode m)
+{
+    const size_t n = std::min<uint64_t>(chunk(seq), count - seq);
+
+    if (m == mode::single)
+    {
+        record r;
+        fill(r, seq);
+        return queue.push(r) ? 1 : 0;
+    }
+    else if (m == mode::bulk)
+    {
+        record r[7];
+        for (size_t i = 0; i < n; i++)
+            fill(r[i], seq + i);
+
+        return queue.push_n(r, n);
+    }
+    else
+    {
+        const auto region = queue.reserve(n);
+        for (size_t i = 0; i < region.first.size; i++)
+            fill(region.first.data[i], seq + i);
+        for (size_t i = 0; i < region.second.size; i++)
+            fill(region.second.data[i], seq + region.first.size + i);
+
+        queue.commit(region.size());
+        return region.size();
+    }
+}
+
+template<size_t N>
+size_t consume(libs::fast_queue<record, N> &queue, uint64_t seq, mode m, std::atomic<bool> &ok)
+{
+    if (m == mode::single)
+    {
+        record r;
+        if (!queue.pop(r))
+            return 0;
+
+        ok = verify(r, seq);
+        return 1;
+    }
+    else if (m == mode::bulk)
+    {
+        record r[7];
+        const size_t n = queue.pop_n(r, chunk(seq));
+        for (size_t i = 0; i < n && ok; i++)
+            ok = verify(r[i], seq + i);
+
+        return n;
+    }
+    else
+    {
+        const auto region = queue.peek(chunk(seq));
+        for (size_t i = 0; i < region.first.size && ok; i++)
+            ok = verify(region.first.data[i], seq + i);
+        for (size_t i = 0; i < region.second.size && ok; i++)
+            ok = verify(region.second.data[i], seq + region.first.size + i);
+
+        queue.consume(region.size());
+        return region.size();
+    }
+}
+
+template<size_t N>
+bool stress(uint64_t count, mode m)
+{
+    static libs::fast_queue<record, N> queue;
+    std::atomic<bool> ok {true};
+
+    std::thread consumer([&]()
+    {
+        for (uint64_t seq = 0; seq < count && ok;)
+        {
+            const size_t n = consume(queue, seq, m, ok);
+            if (n == 0)
+                std::this_thread::yield();
+
+            seq += n;
+        }
+
+        if (!ok)
+            std::printf("Corrupted element\n");
+    });
+
+    for (uint64_t seq = 0; seq < count && ok;)
+    {
+        const size_t n = produce(queue, seq, count, m);
+        if (n == 0)
+            std::this_thread::yield();
+
+        seq += n;
+    }
+
+    consumer.join();
+
+    if (ok && !queue.empty())
+    {
+        std::printf("Queue not empty after test\n");
+        ok = false;
+    }
+
+    std::printf("fast_queue<%zu> %s: %llu elements %s\n", N, mode_names[static_cast<int>(m)],
+                static_cast<unsigned long long>(count), ok ? "OK" : "FAILED");
+    return ok.load();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    const uint64_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50000;
+
+    bool ok = true;
+
+    for (mode m : { mode::single, mode::bulk, mode::in_place })
+    {
+        ok &= stress<1>(count / 10, m);
+        ok &= stress<4>(count, m);
+        ok &= stress<256>(count, m);
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+/*
+ * mpsc_queue_stress.cpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+/* Several producer threads push into small queue, consumer verifies that elements of each
+ * producer arrive complete and in order. Built with ThreadSanitizer by 'make stress'. */
+
+#include <libs/mpsc_queue.hpp>
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t producers = 4;
+
+struct record
+{
+    uint32_t producer;
+    uint32_t seq;
+    uint64_t check;
+};
+
+uint64_t checksum(uint32_t producer, uint32_t seq)
+{
+    return ~((static_cast<uint64_t>(producer) << 32) | seq);
+}
+
+template<size_t N>
+bool stress(uint32_t count)
+{
+    static libs::mpsc_queue<record, N> queue;
+    std::vector<std::thread> threads;
+
+    for (uint32_t p = 0; p < producers; p++)
+    {
+        threads.emplace_back([p, count]()
+        {
+            for (uint32_t seq = 0; seq < count;)
+            {
+                if (queue.push({ p, seq, checksum(p, seq) }))
+                    seq++;
+                else
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    uint32_t expected[producers] {};
+    bool ok = true;
+
+    for (uint32_t received = 0; received < count * producers && ok;)
+    {
+        record r;
+        if (!queue.pop(r))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        ok = r.producer < producers && r.seq == expected[r.producer] && r.check == checksum(r.producer, r.seq);
+        if (ok)
+            expected[r.producer]++;
+
+        received++;
+    }
+
+    if (!ok)
+        std::printf("Corrupted or reordered element\n");
+
+    for (auto &t : threads)
+    {
+        /* Producers are stuck on full queue if consumer gave up */
+        if (!ok)
+            t.detach();
+        else
+            t.join();
+    }
+
+    if (ok && !queue.empty())
+    {
+        std::printf("Queue not empty after test\n");
+        ok = false;
+    }
+
+    std::printf("mpsc_queue<%zu>: %zu x %u elements %s\n", N, producers, count, ok ? "OK" : "FAILED");
+    return ok;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    const uint32_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+
+    bool ok = true;
+    ok &= stress<2>(count / 10);
+    ok &= stress<4>(count);
+    ok &= stress<256>(count);
+
+    return ok ? 0 : 1;
+}
@@ -10,58 +10,205 @@
 #define FAST_QUEUE_HPP_
 
 #include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cassert>
 
 namespace libs
 {
 
-/* Single Producer - Single Consumer queue with no locks */
+/* Size of data cache line, indices of producer and consumer are kept on separate lines */
+#if defined(__ARM_ARCH_7EM__)
+inline constexpr size_t cache_line_size = 32;
+#else
+inline constexpr size_t cache_line_size = 64;
+#endif
+
+/* Single Producer - Single Consumer queue with no locks.
+ * Producer and consumer may be different threads or interrupt and thread.
+ * Indices run freely and are masked on access, so all N elements are usable. */
 template<typename T, size_t N>
 class fast_queue
 {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "Queue size must be power of 2");
+
 public:
-    fast_queue() : read_idx {0}, write_idx {0} {}
+    /* Contiguous part of queue storage */
+    template<typename E>
+    struct segment
+    {
+        E *data;
+        size_t size;
+    };
+
+    /* Region of queue storage, split in two when it wraps around the end of storage */
+    template<typename E>
+    struct region
+    {
+        segment<E> first;
+        segment<E> second;
+
+        size_t size() const
+        {
+            return this->first.size + this->second.size;
+        }
+    };
+
+    fast_queue() {}
     ~fast_queue() {}
 
+    fast_queue(const fast_queue&) = delete;
+    fast_queue& operator=(const fast_queue&) = delete;
+
+    /* Exact when called by consumer, may report already popped elements when called by producer */
     bool empty() const
     {
-        return this->read_idx == this->write_idx;
+        return this->size() == 0;
     }
 
-    constexpr size_t size() const
+    /* Exact only when neither producer nor consumer is active */
+    size_t size() const
     {
-        return this->write_idx - this->read_idx;
+        const size_t read = this->consumer.read_idx.load(std::memory_order_acquire);
+        const size_t write = this->producer.write_idx.load(std::memory_order_acquire);
+        return write - read;
     }
 
     constexpr size_t max_size() const
     {
-        return this->maximum_size;
+        return N;
     }
 
+    /* Producer side */
     bool push(const T &element)
     {
-        if (this->size() == this->maximum_size)
-            return false;
+        const size_t write = this->producer.write_idx.load(std::memory_order_relaxed);
+
+        /* Look at consumer index only when queue seems full */
+        if (write - this->producer.read_cache == N)
+        {
+            this->producer.read_cache = this->consumer.read_idx.load(std::memory_order_acquire);
+            if (write - this->producer.read_cache == N)
+                return false;
+        }
 
-        this->elements[this->write_idx % this->maximum_size] = element;
-        this->write_idx++;
+        this->elements[write & mask] = element;
+        this->producer.write_idx.store(write + 1, std::memory_order_release);
         return true;
     }
 
+    /* Consumer side */
     bool pop(T &element)
     {
-        if (this->empty())
-            return false;
+        const size_t read = this->consumer.read_idx.load(std::memory_order_relaxed);
 
-        element = this->elements[this->read_idx % this->maximum_size];
-        this->read_idx++;
+        /* Look at producer index only when queue seems empty */
+        if (read == this->consumer.write_cache)
+        {
+            this->consumer.write_cache = this->producer.write_idx.load(std::memory_order_acquire);
+            if (read == this->consumer.write_cache)
+                return false;
+        }
+
+        element = this->elements[read & mask];
+        this->consumer.read_idx.store(read + 1, std::memory_order_release);
         return true;
     }
 
+    /* Producer side, returns number of elements pushed */
+    size_t push_n(const T *data, size_t count)
+    {
+        const region<T> r = this->reserve(count);
+
+        std::copy_n(data, r.first.size, r.first.data);
+        std::copy_n(data + r.first.size, r.second.size, r.second.data);
+
+        this->commit(r.size());
+        return r.size();
+    }
+
+    /* Consumer side, returns number of elements popped */
+    size_t pop_n(T *data, size_t count)
+    {
+        const region<const T> r = this->peek(count);
+
+        std::copy_n(r.first.data, r.first.size, data);
+        std::copy_n(r.second.data, r.second.size, data + r.first.size);
+
+        this->consume(r.size());
+        return r.size();
+    }
+
+    /* Producer side, gives free storage for up to 'count' elements to be filled in place
+     * (e.g. by DMA). Elements become visible to consumer after commit(). */
+    region<T> reserve(size_t count)
+    {
+        const size_t write = this->producer.write_idx.load(std::memory_order_relaxed);
+
+        if (N - (write - this->producer.read_cache) < count)
+            this->producer.read_cache = this->consumer.read_idx.load(std::memory_order_acquire);
+
+        count = std::min(count, N - (write - this->producer.read_cache));
+        return this->split<T>(write, count);
+    }
+
+    /* Producer side, publishes first 'count' elements of last reservation */
+    void commit(size_t count)
+    {
+        const size_t write = this->producer.write_idx.load(std::memory_order_relaxed);
+        assert(write + count - this->producer.read_cache <= N);
+        this->producer.write_idx.store(write + count, std::memory_order_release);
+    }
+
+    /* Consumer side, gives up to 'count' queued elements to be processed in place */
+    region<const T> peek(size_t count = N)
+    {
+        const size_t read = this->consumer.read_idx.load(std::memory_order_relaxed);
+
+        if (this->consumer.write_cache - read < count)
+            this->consumer.write_cache = this->producer.write_idx.load(std::memory_order_acquire);
+
+        count = std::min(count, this->consumer.write_cache - read);
+        return this->split<const T>(read, count);
+    }
+
+    /* Consumer side, frees first 'count' elements of last peek */
+    void consume(size_t count)
+    {
+        const size_t read = this->consumer.read_idx.load(std::memory_order_relaxed);
+        assert(this->consumer.write_cache - read >= count);
+        this->consumer.read_idx.store(read + count, std::memory_order_release);
+    }
+
 private:
-    /* When read_idx == write_idx queue is empty, so storage should be +1 size */
-    size_t read_idx, write_idx;
-    std::array<T, N + 1> elements;
-    static constexpr size_t maximum_size = N - 1;
+    static constexpr size_t mask = N - 1;
+
+    template<typename E>
+    region<E> split(size_t index, size_t count)
+    {
+        const size_t offset = index & mask;
+        const size_t first = std::min(count, N - offset);
+        return { { &this->elements[offset], first }, { &this->elements[0], count - first } };
+    }
+
+    /* Written by producer, cached index of consumer is touched by producer only */
+    struct alignas(cache_line_size) producer_indices
+    {
+        std::atomic<size_t> write_idx {0};
+        size_t read_cache {0};
+    };
+
+    /* Written by consumer, cached index of producer is touched by consumer only */
+    struct alignas(cache_line_size) consumer_indices
+    {
+        std::atomic<size_t> read_idx {0};
+        size_t write_cache {0};
+    };
+
+    producer_indices producer;
+    consumer_indices consumer;
+    alignas(cache_line_size) std::array<T, N> elements;
 };
 
 }
@@ -0,0 +1,119 @@
+/*
+ * mpsc_queue.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef MPSC_QUEUE_HPP_
+#define MPSC_QUEUE_HPP_
+
+#include <libs/fast_queue.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace libs
+{
+
+/* Multiple Producers - Single Consumer bounded queue with no locks (D. Vyukov's array queue).
+ * Each cell carries sequence number telling whether it is free for producer of given lap
+ * or filled for consumer. Producers claim cells with compare-and-swap (LDREX/STREX on Cortex-M7),
+ * so they never wait for each other, yet consumer may see claimed cell which is not filled yet. */
+template<typename T, size_t N>
+class mpsc_queue
+{
+    static_assert(N > 1 && (N & (N - 1)) == 0, "Queue size must be power of 2 greater than 1");
+
+public:
+    mpsc_queue()
+    {
+        for (size_t i = 0; i < N; i++)
+            this->cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    /* Consumer side */
+    bool empty() const
+    {
+        const cell &c = this->cells[this->dequeue_pos & mask];
+        return c.sequence.load(std::memory_order_acquire) != this->dequeue_pos + 1;
+    }
+
+    constexpr size_t max_size() const
+    {
+        return N;
+    }
+
+    /* Producer side, may be called concurrently from many threads and interrupts */
+    bool push(const T &element)
+    {
+        size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+        cell *c;
+
+        while (true)
+        {
+            c = &this->cells[pos & mask];
+            const size_t sequence = c->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+            if (diff == 0)
+            {
+                /* Cell is free in this lap, try to claim it */
+                if (this->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                /* Cell still holds element of previous lap, queue is full */
+                return false;
+            }
+            else
+            {
+                /* Other producer claimed the cell */
+                pos = this->enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        c->data = element;
+        c->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* Consumer side */
+    bool pop(T &element)
+    {
+        cell &c = this->cells[this->dequeue_pos & mask];
+
+        if (c.sequence.load(std::memory_order_acquire) != this->dequeue_pos + 1)
+            return false;
+
+        element = c.data;
+
+        /* Free the cell for producers of the next lap */
+        c.sequence.store(this->dequeue_pos + N, std::memory_order_release);
+        this->dequeue_pos++;
+        return true;
+    }
+
+private:
+    static constexpr size_t mask = N - 1;
+
+    struct cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    alignas(cache_line_size) std::array<cell, N> cells;
+    alignas(cache_line_size) std::atomic<size_t> enqueue_pos {0};
+    alignas(cache_line_size) size_t dequeue_pos {0};
+};
+
+}
+
+#endif /* MPSC_QUEUE_HPP_ */
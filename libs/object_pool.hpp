@@ -0,0 +1,136 @@
+/*
+ * object_pool.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef OBJECT_POOL_HPP_
+#define OBJECT_POOL_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace libs
+{
+
+/* Fixed-capacity pool of objects with O(1) lock-free allocation and release.
+ * Free blocks are kept on a LIFO list whose head is tagged with a counter to
+ * avoid the ABA problem, so it is safe to use from threads and interrupts. */
+template<typename T, size_t N>
+class object_pool
+{
+    static_assert(N > 0 && N < 0xFFFF, "Pool capacity must fit in 16-bit index");
+
+public:
+    struct statistics
+    {
+        size_t capacity;
+        size_t used;
+        size_t high_water;
+        uint32_t exhausted;
+    };
+
+    object_pool() : head {0}, used {0}, high_water {0}, exhausted {0}
+    {
+        for (size_t i = 0; i < N; i++)
+            this->next[i].store(static_cast<uint16_t>(i + 1), std::memory_order_relaxed);
+    }
+
+    ~object_pool() {}
+
+    object_pool(const object_pool&) = delete;
+    object_pool& operator=(const object_pool&) = delete;
+
+    template<typename... Args>
+    T *allocate(Args&&... args)
+    {
+        uint32_t old_head = this->head.load(std::memory_order_acquire);
+        uint32_t new_head;
+        uint16_t index;
+
+        do
+        {
+            index = old_head & 0xFFFF;
+            if (index == empty_index)
+            {
+                this->exhausted.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            new_head = next_tag(old_head) | this->next[index].load(std::memory_order_relaxed);
+        }
+        while (!this->head.compare_exchange_weak(old_head, new_head, std::memory_order_acquire, std::memory_order_acquire));
+
+        const size_t in_use = this->used.fetch_add(1, std::memory_order_relaxed) + 1;
+        size_t peak = this->high_water.load(std::memory_order_relaxed);
+        while (in_use > peak && !this->high_water.compare_exchange_weak(peak, in_use, std::memory_order_relaxed));
+
+        return new (this->storage[index]) T(std::forward<Args>(args)...);
+    }
+
+    void release(T *object)
+    {
+        const uint16_t index = this->index_of(object);
+        object->~T();
+
+        uint32_t old_head = this->head.load(std::memory_order_relaxed);
+        uint32_t new_head;
+
+        do
+        {
+            this->next[index].store(old_head & 0xFFFF, std::memory_order_relaxed);
+            new_head = next_tag(old_head) | index;
+        }
+        while (!this->head.compare_exchange_weak(old_head, new_head, std::memory_order_release, std::memory_order_relaxed));
+
+        this->used.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    bool owns(const T *object) const
+    {
+        const auto *ptr = reinterpret_cast<const uint8_t*>(object);
+        return ptr >= this->storage[0] && ptr < reinterpret_cast<const uint8_t*>(this->storage + N);
+    }
+
+    constexpr size_t capacity() const
+    {
+        return N;
+    }
+
+    statistics get_statistics() const
+    {
+        return { N,
+                 this->used.load(std::memory_order_relaxed),
+                 this->high_water.load(std::memory_order_relaxed),
+                 this->exhausted.load(std::memory_order_relaxed) };
+    }
+
+private:
+    static constexpr uint16_t empty_index = N;
+
+    static constexpr uint32_t next_tag(uint32_t head)
+    {
+        return (head & 0xFFFF0000) + 0x10000;
+    }
+
+    uint16_t index_of(const T *object) const
+    {
+        const auto *ptr = reinterpret_cast<const uint8_t*>(object);
+        return (ptr - this->storage[0]) / sizeof(this->storage[0]);
+    }
+
+    /* Head of free list: upper 16 bits are ABA tag, lower 16 bits are block index */
+    std::atomic<uint32_t> head;
+    std::atomic<uint16_t> next[N];
+    std::atomic<size_t> used, high_water;
+    std::atomic<uint32_t> exhausted;
+    alignas(T) uint8_t storage[N][sizeof(T)];
+};
+
+}
+
+#endif /* OBJECT_POOL_HPP_ */
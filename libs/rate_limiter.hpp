@@ -0,0 +1,135 @@
+/*
+ * rate_limiter.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef RATE_LIMITER_HPP_
+#define RATE_LIMITER_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace libs
+{
+
+/* Token bucket per key (e.g. client address), buckets are kept in small table and bucket
+ * of the least recently seen key is reused for a new one, but only if it was idle long enough
+ * to refill entirely. Otherwise new key is refused, so flood rotating through more keys than
+ * the table holds can't get a fresh bucket with each datagram. Tokens are counted in thousandths,
+ * so refill is exact for any rate with millisecond time. Lookup is linear, so keep table small.
+ * It is not thread safe, caller has to serialize access, only statistics may be read from other threads. */
+template<size_t N>
+class rate_limiter
+{
+    static_assert(N > 0, "Table must hold at least one key");
+
+public:
+    struct statistics
+    {
+        uint32_t allowed;
+        uint32_t dropped;
+        uint32_t evicted;
+        uint32_t rejected;  /* New keys refused, all buckets were in use */
+    };
+
+    /* Rate in events per second, burst is the bucket size in events */
+    rate_limiter(uint32_t rate, uint32_t burst) :
+    rate {rate}, capacity {burst * unit}, refill_time {rate > 0 ? (burst * unit + rate - 1) / rate : UINT32_MAX} {}
+
+    /* Returns false if event of 'key' exceeds its rate, 'now' is time in milliseconds */
+    bool allow(uint32_t key, uint32_t now)
+    {
+        bucket *found = this->find(key, now);
+        if (found == nullptr)
+        {
+            this->rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        bucket &b = *found;
+
+        /* Refill for time elapsed since the last event, 1 token per second is 1 thousandth per ms */
+        const uint32_t elapsed = now - b.updated;
+        const uint64_t tokens = b.tokens + static_cast<uint64_t>(elapsed) * this->rate;
+        b.tokens = tokens < this->capacity ? static_cast<uint32_t>(tokens) : this->capacity;
+        b.updated = now;
+
+        if (b.tokens < unit)
+        {
+            this->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        b.tokens -= unit;
+        this->allowed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    statistics get_statistics() const
+    {
+        return { this->allowed.load(std::memory_order_relaxed),
+                 this->dropped.load(std::memory_order_relaxed),
+                 this->evicted.load(std::memory_order_relaxed),
+                 this->rejected.load(std::memory_order_relaxed) };
+    }
+
+private:
+    static constexpr uint32_t unit = 1000;
+
+    struct bucket
+    {
+        uint32_t key;
+        uint32_t tokens;
+        uint32_t updated;
+        bool used;
+    };
+
+    /* Returns nullptr if key is new and no bucket can be reused */
+    bucket *find(uint32_t key, uint32_t now)
+    {
+        bucket *oldest = &this->buckets[0];
+
+        for (auto &b : this->buckets)
+        {
+            if (b.used && b.key == key)
+                return &b;
+
+            /* Free bucket is preferred, otherwise the one with the longest idle time */
+            if (!b.used)
+            {
+                if (oldest->used)
+                    oldest = &b;
+            }
+            else if (oldest->used && now - b.updated > now - oldest->updated)
+            {
+                oldest = &b;
+            }
+        }
+
+        if (oldest->used)
+        {
+            /* Bucket which has not refilled yet still limits its key */
+            if (now - oldest->updated < this->refill_time)
+                return nullptr;
+
+            this->evicted.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /* New key starts with full bucket, evicted one had refilled entirely anyway */
+        *oldest = { key, this->capacity, now, true };
+        return oldest;
+    }
+
+    const uint32_t rate;
+    const uint32_t capacity;
+    const uint32_t refill_time;     /* Milliseconds to refill empty bucket */
+    bucket buckets[N] {};
+    std::atomic<uint32_t> allowed {0}, dropped {0}, evicted {0}, rejected {0};
+};
+
+}
+
+#endif /* RATE_LIMITER_HPP_ */
@@ -0,0 +1,169 @@
+/*
+ * timer_wheel.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef TIMER_WHEEL_HPP_
+#define TIMER_WHEEL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace libs
+{
+
+/* Intrusive timer, embedded in user object and linked into wheel slot */
+struct timer_node
+{
+    timer_node *prev = nullptr;
+    timer_node *next = nullptr;
+    uint32_t expires = 0;
+    uint32_t period = 0;
+    void (*expired)(timer_node &node) = nullptr;
+
+    bool armed() const
+    {
+        return this->prev != nullptr;
+    }
+};
+
+/* Hierarchical timing wheel with O(1) arm and cancel. Level 0 resolves single ticks,
+ * each next level is 2^slot_bits times coarser and is cascaded into lower levels.
+ * Timeouts longer than range of all levels are parked in the last slot and re-inserted.
+ * It is not thread safe, caller has to serialize access. */
+template<size_t levels = 3, size_t slot_bits = 6>
+class timer_wheel
+{
+    static_assert(levels > 0 && slot_bits * levels < 32, "Wheel range must fit in 32-bit ticks");
+
+public:
+    timer_wheel() : now {0}
+    {
+        for (auto &level : this->slots)
+        {
+            for (auto &slot : level)
+                slot.prev = slot.next = &slot;
+        }
+    }
+
+    timer_wheel(const timer_wheel&) = delete;
+    timer_wheel& operator=(const timer_wheel&) = delete;
+
+    /* Expire after 'timeout' ticks (at least 1), then every 'period' ticks if it is not 0 */
+    void arm(timer_node &node, uint32_t timeout, uint32_t period = 0)
+    {
+        if (node.armed())
+            unlink(node);
+
+        node.expires = this->now + (timeout > 0 ? timeout : 1);
+        node.period = period;
+        this->insert(node);
+    }
+
+    void cancel(timer_node &node)
+    {
+        if (node.armed())
+            unlink(node);
+    }
+
+    /* Advance wheel by one tick and call handlers of expired timers */
+    void tick()
+    {
+        this->now++;
+
+        /* Move timers from coarser levels down, when lower level wraps around */
+        for (size_t level = 1; level < levels; level++)
+        {
+            if (((this->now >> (slot_bits * (level - 1))) & slot_mask) != 0)
+                break;
+
+            this->cascade(level);
+        }
+
+        timer_node &slot = this->slots[0][this->now & slot_mask];
+
+        while (slot.next != &slot)
+        {
+            timer_node &node = *slot.next;
+            unlink(node);
+
+            if (node.period > 0)
+            {
+                node.expires += node.period;
+                this->insert(node);
+            }
+
+            node.expired(node);
+        }
+    }
+
+    uint32_t ticks() const
+    {
+        return this->now;
+    }
+
+private:
+    static constexpr size_t slots_per_level = 1 << slot_bits;
+    static constexpr uint32_t slot_mask = slots_per_level - 1;
+    static constexpr uint32_t range = 1ul << (slot_bits * levels);
+
+    static void unlink(timer_node &node)
+    {
+        node.prev->next = node.next;
+        node.next->prev = node.prev;
+        node.prev = node.next = nullptr;
+    }
+
+    void insert(timer_node &node)
+    {
+        uint32_t delta = node.expires - this->now;
+        uint32_t expires = node.expires;
+
+        if (delta >= range)
+        {
+            /* Park in the furthest slot, it will be re-inserted when cascaded */
+            delta = range - 1;
+            expires = this->now + delta;
+        }
+
+        size_t level = 0;
+        while (level < levels - 1 && delta >= (1ul << (slot_bits * (level + 1))))
+            level++;
+
+        timer_node &slot = this->slots[level][(expires >> (slot_bits * level)) & slot_mask];
+
+        node.next = &slot;
+        node.prev = slot.prev;
+        slot.prev->next = &node;
+        slot.prev = &node;
+    }
+
+    void cascade(size_t level)
+    {
+        timer_node &slot = this->slots[level][(this->now >> (slot_bits * level)) & slot_mask];
+
+        if (slot.next == &slot)
+            return;
+
+        /* Detach the whole list first, re-inserted timers never return to this slot */
+        timer_node *node = slot.next;
+        slot.prev->next = nullptr;
+        slot.prev = slot.next = &slot;
+
+        while (node != nullptr)
+        {
+            timer_node *next = node->next;
+            this->insert(*node);
+            node = next;
+        }
+    }
+
+    uint32_t now;
+    timer_node slots[levels][slots_per_level];
+};
+
+}
+
+#endif /* TIMER_WHEEL_HPP_ */
@@ -5,7 +5,6 @@
  *      Author: kwarc
  */
 
-#include <memory>
 #include <cassert>
 #include <cstdio>
 
@@ -13,6 +12,9 @@
 
 #include "cmsis_os2.h"
 
+#include "middlewares/time_event.hpp"
+#include "middlewares/static_active_object.hpp"
+
 #include "drivers/stm32f7/rcc.hpp"
 #include "drivers/stm32f7/gpio.hpp"
 
@@ -21,9 +23,16 @@
 
 void init_thread(void *arg)
 {
-    /* Create active objects */
-    auto ctrl = std::make_unique<controller>();
-    auto srv = std::make_unique<server>();
+    /* Time events of active objects are driven by wheel ticking every 10ms */
+    middlewares::time_event_service::start(10);
+
+    /* Active objects share one thread, server has higher priority so responses are sent
+     * as soon as controller produces them and server queue stays short */
+    static middlewares::static_cooperative_kernel<2048> kernel __attribute__((section(".dtcmram"))) { "app", osPriorityNormal };
+
+    /* Create active objects in fast RAM, their queues and events are part of them */
+    static controller ctrl __attribute__((section(".dtcmram"))) { kernel, 1 };
+    static server srv __attribute__((section(".dtcmram"))) { kernel, 2 };
 
     osThreadSuspend(osThreadGetId());
 }
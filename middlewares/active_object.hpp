@@ -10,15 +10,92 @@
 
 #include "cmsis_os2.h"
 
+#include <libs/object_pool.hpp>
+
+#include <middlewares/cooperative_kernel.hpp>
+#include <middlewares/mailbox.hpp>
+
+/* Collect per-event latency statistics with CPU cycles counter,
+ * define ACTIVE_OBJECT_STATS_DISABLED in build settings to compile it out */
+#ifndef ACTIVE_OBJECT_STATS_DISABLED
+#define ACTIVE_OBJECT_STATS_ENABLED
+#endif
+
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+#include <drivers/stm32f7/core.hpp>
+#endif
+
+#include <array>
+#include <atomic>
 #include <string>
+#include <variant>
+#include <type_traits>
+#include <utility>
 #include <cassert>
 
 namespace middlewares
 {
 
+/* Event type can opt into a lane with: static constexpr auto lane = middlewares::event_lane::high; */
+template<typename E, typename = void>
+struct event_lane_of
+{
+    static constexpr event_lane value = event_lane::normal;
+};
+
+template<typename E>
+struct event_lane_of<E, std::void_t<decltype(E::lane)>>
+{
+    static constexpr event_lane value = E::lane;
+};
+
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+/* Histogram of CPU cycles, bucket [i] counts samples below 2^(i + bucket_shift) cycles */
+struct latency_histogram
+{
+    static constexpr size_t buckets_count = 16;
+    static constexpr size_t bucket_shift = 6;
+
+    uint32_t count;
+    uint32_t max;
+    uint32_t buckets[buckets_count];
+
+    void add(uint32_t cycles)
+    {
+        size_t bucket = 0;
+        while (bucket < buckets_count - 1 && (cycles >> (bucket + bucket_shift)) != 0)
+            bucket++;
+
+        this->buckets[bucket]++;
+        this->count++;
+        if (cycles > this->max)
+            this->max = cycles;
+    }
+};
+#endif
+
 template<typename T>
+struct event_lanes;
+
+template<typename... Ts>
+struct event_lanes<std::variant<Ts...>>
+{
+    static constexpr event_lane table[] = { event_lane_of<Ts>::value... };
+};
+
+/* What non-blocking send does when the lane is full */
+enum class overflow_policy : uint8_t
+{
+    drop_newest,    /* Discard the event being sent */
+    drop_oldest,    /* Discard the oldest queued event of the same lane, if transport can do it */
+    coalesce,       /* Discard the event if one of the same type is still queued */
+};
+
+template<typename T, size_t pool_size = 32, size_t max_batch = 1, typename transport = os_queue_transport>
 class active_object
 {
+    static_assert(max_batch > 0, "At least one event must be dispatched per wakeup");
+
 public:
     struct event
     {
@@ -26,84 +103,453 @@ public:
         uint32_t flags;
         enum flags { immutable = 1 << 0 };
         event(const T &data, uint32_t flags = 0) : data {data}, flags {flags} {}
+        event(T &&data, uint32_t flags = 0) : data {std::move(data)}, flags {flags} {}
+
+        event_lane lane() const
+        {
+            return event_lanes<T>::table[this->data.index()];
+        }
     };
 
-    active_object(const std::string_view &name, osPriority_t priority, size_t stack_size, uint32_t queue_size = 32)
+    /* Events drained in one wakeup, ordered by lane */
+    struct event_batch
+    {
+        event * const *events;
+        size_t count;
+
+        size_t size() const { return this->count; }
+        const event &operator[](size_t i) const { return *this->events[i]; }
+    };
+
+    /* Histogram of drained batch sizes, element [i] counts batches of i + 1 events */
+    using batch_statistics = std::array<uint32_t, max_batch>;
+
+    struct send_statistics
+    {
+        uint32_t dropped;
+        uint32_t overwritten;
+        uint32_t coalesced;
+    };
+
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+    /* Updated by worker thread only, so reader may see histogram in the middle of update */
+    struct latency_statistics
+    {
+        latency_histogram queue_wait[std::variant_size_v<T>];
+        latency_histogram handler[std::variant_size_v<T>];
+    };
+
+    /* Highest depth of each lane, posts in progress included */
+    using depth_statistics = std::array<uint16_t, event_lane_count>;
+#endif
+
+    /* Item of lane queue */
+    struct message
+    {
+        event *evt;
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+        uint32_t sent_at;
+#endif
+    };
+
+    active_object(const std::string_view &name, osPriority_t priority, size_t stack_size, uint32_t queue_size = 32,
+                  const active_object_memory &memory = {}) :
+        mailbox {name, queue_size, memory}
     {
         /* It is assumed that each active object is unique */
         assert(this->instance == nullptr);
         this->instance = this;
 
-        /* Create queue of events */
-        this->queue_attr.name = name.data();
-
-        this->queue = osMessageQueueNew(queue_size, sizeof(event*), &this->queue_attr);
-        assert(this->queue != nullptr);
-
         /* Create worker thread */
         this->thread_attr.name = name.data();
         this->thread_attr.priority = priority;
         this->thread_attr.stack_size = stack_size;
+        this->thread_attr.cb_mem = memory.thread.cb;
+        this->thread_attr.cb_size = memory.thread.cb_size;
+        this->thread_attr.stack_mem = memory.thread.mem;
 
         this->thread = osThreadNew(active_object::thread_loop, this, &this->thread_attr);
         assert(this->thread != nullptr);
     }
 
-    virtual ~active_object()
+    /* Active object without own thread, dispatched by kernel shared with other active objects */
+    active_object(const std::string_view &name, cooperative_kernel &kernel, uint8_t priority, uint32_t queue_size = 32,
+                  const active_object_memory &memory = {}) :
+        mailbox {name, queue_size, memory}
     {
-        osStatus_t status;
-        status = osMessageQueueDelete(this->queue);
-        assert(status == osOK);
-        this->queue = nullptr;
+        assert(this->instance == nullptr);
+        this->instance = this;
 
-        status = osThreadTerminate(this->thread);
-        assert(status == osOK);
-        this->thread = nullptr;
+        kernel.attach(priority, active_object::run, this);
+        this->kernel_priority = priority;
+        this->kernel = &kernel;
+
+        /* Events posted before kernel was set would not wake it */
+        kernel.notify(priority);
+    }
+
+    /* Mailbox is deleted after worker thread is stopped */
+    virtual ~active_object()
+    {
+        if (this->kernel != nullptr)
+        {
+            this->kernel->detach(this->kernel_priority);
+            this->kernel = nullptr;
+        }
+        else
+        {
+            const osStatus_t status = osThreadTerminate(this->thread);
+            assert(status == osOK);
+            (void)status;
+            this->thread = nullptr;
+        }
 
         this->instance = nullptr;
     }
 
-    void send(const event &e, uint32_t timeout = osWaitForever)
+    /* Returns false if event was dropped (counted in send statistics), it happens
+     * only when timeout expires, or at once when called in the thread of own kernel */
+    bool send(const event &e, uint32_t timeout = osWaitForever)
     {
-        const event *evt = nullptr;
+        return this->send_event(e, timeout);
+    }
 
-        if (e.flags & event::flags::immutable)
-            evt = &e;
-        else
-            evt = new event(e);
+    /* Event is moved into the pool, so its data may own resources (e.g. move-only handle) */
+    bool send(event &&e, uint32_t timeout = osWaitForever)
+    {
+        return this->send_event(std::move(e), timeout);
+    }
 
-        assert(evt != nullptr);
-        assert(osMessageQueuePut(this->queue, &evt, 0, timeout) == osOK);
+    /* Never blocks nor allocates from heap, returns false if event was dropped */
+    bool try_send(const event &e, overflow_policy policy = overflow_policy::drop_newest)
+    {
+        return this->try_send_event(e, policy);
     }
 
+    /* Dropped event is destroyed, so resources owned by its data are freed */
+    bool try_send(event &&e, overflow_policy policy = overflow_policy::drop_newest)
+    {
+        return this->try_send_event(std::move(e), policy);
+    }
+
+    /* Dropping oldest event may free it to heap, which is not allowed in interrupt */
+    bool send_from_isr(const event &e, overflow_policy policy = overflow_policy::drop_newest)
+    {
+        assert(policy != overflow_policy::drop_oldest);
+        return this->try_send(e, policy);
+    }
+
+    auto get_pool_statistics() const
+    {
+        return this->event_pool.get_statistics();
+    }
+
+    batch_statistics get_batch_statistics() const
+    {
+        batch_statistics stats;
+
+        for (size_t i = 0; i < max_batch; i++)
+            stats[i] = this->batch_sizes[i].load(std::memory_order_relaxed);
+
+        return stats;
+    }
+
+    send_statistics get_send_statistics() const
+    {
+        return { this->dropped.load(std::memory_order_relaxed),
+                 this->overwritten.load(std::memory_order_relaxed),
+                 this->coalesced.load(std::memory_order_relaxed) };
+    }
+
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+    const latency_statistics &get_latency_statistics() const
+    {
+        return this->latency;
+    }
+
+    depth_statistics get_depth_high_water() const
+    {
+        depth_statistics stats;
+
+        for (size_t i = 0; i < stats.size(); i++)
+            stats[i] = this->depth_high_water[i].load(std::memory_order_relaxed);
+
+        return stats;
+    }
+#endif
+
     /* Used for global access (e.g. from interrupt) */
     static inline active_object *instance;
 private:
     virtual void dispatch(const event &e) = 0;
 
+    /* Optional hook to handle all events drained in one wakeup at once.
+     * Handler time of each event is recorded only by this default implementation. */
+    virtual void dispatch_batch(const event_batch &batch)
+    {
+        for (size_t i = 0; i < batch.size(); i++)
+            this->dispatch_timed(batch[i]);
+    }
+
+    void dispatch_timed(const event &e)
+    {
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+        const uint32_t start = cycles();
+        this->dispatch(e);
+        this->latency.handler[e.data.index()].add(cycles() - start);
+#else
+        this->dispatch(e);
+#endif
+    }
+
+    /* Optional hook called when dispatched events were the last ones queued, e.g. to flush buffered output */
+    virtual void dispatch_idle()
+    {
+
+    }
+
     static void thread_loop(void *arg)
     {
         active_object *this_ = static_cast<active_object*>(arg);
 
         while (true)
+            this_->process(osWaitForever);
+    }
+
+    /* Called by cooperative kernel */
+    static bool run(void *arg)
+    {
+        return static_cast<active_object*>(arg)->process(0);
+    }
+
+    /* Dispatch up to max_batch events, returns false if none arrived within timeout */
+    bool process(uint32_t timeout)
+    {
+        const size_t available = this->mailbox.wait(max_batch, timeout);
+
+        /* Take events in lane order */
+        event *events[max_batch];
+        size_t count = 0;
+
+        while (count < available)
+        {
+            message msg;
+            if (!this->take(msg))
+                break;
+
+            events[count++] = msg.evt;
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+            this->latency.queue_wait[msg.evt->data.index()].add(cycles() - msg.sent_at);
+#endif
+        }
+
+        if (count == 0)
+            return false;
+
+        this->batch_sizes[count - 1].fetch_add(1, std::memory_order_relaxed);
+
+        if (count == 1)
+            this->dispatch_timed(*events[0]);
+        else
+            this->dispatch_batch({ events, count });
+
+        for (size_t i = 0; i < count; i++)
+            this->release(events[i]);
+
+        if (this->idle())
+            this->dispatch_idle();
+
+        return true;
+    }
+
+    template<typename E>
+    bool send_event(E &&e, uint32_t timeout)
+    {
+        event *evt = this->acquire(std::forward<E>(e));
+
+        /* Pool exhausted, fall back to heap (counted in pool statistics) */
+        if constexpr (std::is_constructible_v<event, E>)
+        {
+            if (evt == nullptr)
+                evt = new event(std::forward<E>(e));
+        }
+
+        if (evt == nullptr)
+        {
+            assert(!"Event with move-only data must be moved in or be immutable");
+            this->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        /* Waiting in the thread of own kernel would never end,
+         * queues must be large enough for events exchanged inside the kernel */
+        if (this->kernel != nullptr && this->kernel->is_current_thread())
+            timeout = 0;
+
+        if (this->post(evt, timeout))
+            return true;
+
+        this->release(evt);
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    template<typename E>
+    bool try_send_event(E &&e, overflow_policy policy)
+    {
+        if (policy == overflow_policy::coalesce && this->queued[e.data.index()].load(std::memory_order_relaxed) > 0)
+        {
+            this->coalesced.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        event *evt = this->acquire(std::forward<E>(e));
+
+        if (evt != nullptr)
         {
-            event *evt = nullptr;
-            uint8_t evt_prio = 0;
+            if (this->post(evt, 0))
+                return true;
 
-            if (osMessageQueueGet(this_->queue, &evt, &evt_prio, osWaitForever) == osOK)
-            {
-                this_->dispatch(*evt);
+            if (policy == overflow_policy::drop_oldest && this->drop_oldest(evt->lane()) && this->post(evt, 0))
+                return true;
 
-                if (!((*evt).flags & event::flags::immutable))
-                    delete evt;
-            }
+            this->release(evt);
         }
+
+        this->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /* Event is constructed in the pool from copied or moved one, nothing is moved if pool is exhausted.
+     * Event with move-only data can't be copied, so by reference only immutable one can be sent. */
+    template<typename E>
+    event *acquire(E &&e)
+    {
+        if (e.flags & event::flags::immutable)
+            return const_cast<event*>(&e);
+
+        if constexpr (std::is_constructible_v<event, E>)
+            return this->event_pool.allocate(std::forward<E>(e));
+        else
+            return nullptr;
     }
 
-    osMessageQueueId_t queue;
-    osMessageQueueAttr_t queue_attr = { 0 };
-    osThreadId_t thread;
+    bool post(event *evt, uint32_t timeout)
+    {
+        auto &count = this->queued[evt->data.index()];
+        count.fetch_add(1, std::memory_order_relaxed);
+
+        const size_t lane = static_cast<size_t>(evt->lane());
+        message msg { evt };
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+        msg.sent_at = cycles();
+
+        /* Counted before put, so consumer never decrements depth first. Producers run in
+         * several threads and interrupts, so high-water mark is raised with atomic max. */
+        const uint16_t depth = this->depth[lane].fetch_add(1, std::memory_order_relaxed) + 1;
+        uint16_t high_water = this->depth_high_water[lane].load(std::memory_order_relaxed);
+        while (depth > high_water && !this->depth_high_water[lane].compare_exchange_weak(high_water, depth, std::memory_order_relaxed));
+#endif
+
+        if (!this->mailbox.put(lane, msg, timeout))
+        {
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+            this->depth[lane].fetch_sub(1, std::memory_order_relaxed);
+#endif
+            count.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (this->kernel != nullptr)
+            this->kernel->notify(this->kernel_priority);
+
+        return true;
+    }
+
+    bool drop_oldest(event_lane lane)
+    {
+        message msg { nullptr };
+
+        if (!this->mailbox.drop_oldest(static_cast<size_t>(lane), msg))
+            return false;
+
+        /* Lane was drained in the meantime, there is space now */
+        if (msg.evt == nullptr)
+            return true;
+
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+        this->depth[static_cast<size_t>(lane)].fetch_sub(1, std::memory_order_relaxed);
+#endif
+        this->queued[msg.evt->data.index()].fetch_sub(1, std::memory_order_relaxed);
+        this->release(msg.evt);
+        this->overwritten.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /* No event is queued nor being posted */
+    bool idle() const
+    {
+        for (const auto &count : this->queued)
+        {
+            if (count.load(std::memory_order_relaxed) > 0)
+                return false;
+        }
+
+        return true;
+    }
+
+    bool take(message &msg)
+    {
+        if (!this->mailbox.take(msg))
+            return false;
+
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+        this->depth[static_cast<size_t>(msg.evt->lane())].fetch_sub(1, std::memory_order_relaxed);
+#endif
+        this->queued[msg.evt->data.index()].fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void release(event *evt)
+    {
+        if (evt->flags & event::flags::immutable)
+            return;
+
+        if (this->event_pool.owns(evt))
+            this->event_pool.release(evt);
+        else
+        {
+            /* GCC cannot see that events from the pool never get here */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfree-nonheap-object"
+            delete evt;
+#pragma GCC diagnostic pop
+        }
+    }
+
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+    static uint32_t cycles()
+    {
+        return drivers::core::get_cycles_counter();
+    }
+#endif
+
+    static constexpr size_t lanes = event_lane_count;
+
+    libs::object_pool<event, pool_size> event_pool;
+    std::atomic<uint32_t> batch_sizes[max_batch] {};
+    std::atomic<uint16_t> queued[std::variant_size_v<T>] {};
+    std::atomic<uint32_t> dropped {0}, overwritten {0}, coalesced {0};
+#ifdef ACTIVE_OBJECT_STATS_ENABLED
+    std::atomic<uint16_t> depth[lanes] {};
+    std::atomic<uint16_t> depth_high_water[lanes] {};
+    latency_statistics latency {};
+#endif
+    typename transport::template mailbox<message> mailbox;
+    osThreadId_t thread = nullptr;
     osThreadAttr_t thread_attr = { 0 };
+    cooperative_kernel *kernel = nullptr;
+    uint8_t kernel_priority = 0;
 };
 
 }
@@ -0,0 +1,133 @@
+/*
+ * cooperative_kernel.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef COOPERATIVE_KERNEL_HPP_
+#define COOPERATIVE_KERNEL_HPP_
+
+#include "cmsis_os2.h"
+
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+namespace middlewares
+{
+
+/* Run-to-completion scheduler of active objects sharing one thread. Active object is ready
+ * when it has queued events, ready set is kept in thread flags (bit per priority), so posting
+ * from other threads or interrupts wakes the kernel. After each dispatched batch the ready
+ * active object with the highest priority is served next, handlers are never preempted
+ * by other active objects of the same kernel. */
+class cooperative_kernel
+{
+public:
+    /* Returns false if active object has no event to dispatch */
+    using run_fn = bool (*)(void *context);
+
+    /* One bit of thread flags per priority, the highest bit is reserved by CMSIS for errors */
+    static constexpr uint8_t max_priorities = 31;
+
+    struct thread_memory
+    {
+        void *cb;
+        uint32_t cb_size;
+        void *stack;
+        uint32_t stack_size;
+    };
+
+    cooperative_kernel(const std::string_view &name, osPriority_t priority, size_t stack_size,
+                       const thread_memory &memory = {})
+    {
+        this->thread_attr.name = name.data();
+        this->thread_attr.priority = priority;
+        this->thread_attr.stack_size = stack_size;
+        this->thread_attr.cb_mem = memory.cb;
+        this->thread_attr.cb_size = memory.cb_size;
+        this->thread_attr.stack_mem = memory.stack;
+
+        this->thread = osThreadNew(cooperative_kernel::thread_loop, this, &this->thread_attr);
+        assert(this->thread != nullptr);
+    }
+
+    ~cooperative_kernel()
+    {
+        const osStatus_t status = osThreadTerminate(this->thread);
+        assert(status == osOK);
+        (void)status;
+    }
+
+    cooperative_kernel(const cooperative_kernel&) = delete;
+    cooperative_kernel& operator=(const cooperative_kernel&) = delete;
+
+    /* Priority is unique per kernel, higher value is served first.
+     * Active object is read by kernel only after it was notified, so attach it before posting to it. */
+    void attach(uint8_t priority, run_fn run, void *context)
+    {
+        assert(priority < max_priorities);
+        assert(this->members[priority].run == nullptr);
+        this->members[priority] = { run, context };
+    }
+
+    /* Active object must not be dispatched at the moment, e.g. detach it from its own handler */
+    void detach(uint8_t priority)
+    {
+        this->members[priority] = {};
+    }
+
+    /* Mark active object as ready, may be called from interrupt */
+    void notify(uint8_t priority)
+    {
+        osThreadFlagsSet(this->thread, 1ul << priority);
+    }
+
+    bool is_current_thread() const
+    {
+        return osThreadGetId() == this->thread;
+    }
+
+private:
+    struct member
+    {
+        run_fn run;
+        void *context;
+    };
+
+    static void thread_loop(void *arg)
+    {
+        cooperative_kernel *this_ = static_cast<cooperative_kernel*>(arg);
+        constexpr uint32_t all = (1ul << max_priorities) - 1;
+        uint32_t ready = 0;
+
+        while (true)
+        {
+            /* Block only when idle, otherwise just collect newly ready active objects */
+            const uint32_t flags = osThreadFlagsWait(all, osFlagsWaitAny, ready != 0 ? 0 : osWaitForever);
+            if ((flags & osFlagsError) == 0)
+                ready |= flags;
+
+            if (ready == 0)
+                continue;
+
+            const uint8_t priority = 31 - __builtin_clz(ready);
+
+            const member &m = this_->members[priority];
+
+            /* Active object stays ready until its queues are found empty */
+            if (m.run == nullptr || !m.run(m.context))
+                ready &= ~(1ul << priority);
+        }
+    }
+
+    member members[max_priorities] {};
+    osThreadId_t thread;
+    osThreadAttr_t thread_attr = { 0 };
+};
+
+}
+
+#endif /* COOPERATIVE_KERNEL_HPP_ */
@@ -0,0 +1,387 @@
+/*
+ * mailbox.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef MAILBOX_HPP_
+#define MAILBOX_HPP_
+
+#include "cmsis_os2.h"
+
+#include <libs/mpsc_queue.hpp>
+
+#include <string_view>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+namespace middlewares
+{
+
+/* Mailbox lanes, lower value is served first */
+enum class event_lane : uint8_t
+{
+    high,
+    normal,
+};
+
+inline constexpr size_t event_lane_count = 2;
+
+/* Memory for kernel objects of active object, blocks left empty are allocated from heap */
+struct active_object_memory
+{
+    struct block
+    {
+        void *cb;
+        uint32_t cb_size;
+        void *mem;
+        uint32_t mem_size;
+    };
+
+    block thread;
+    block queues[event_lane_count];
+    block pending;
+};
+
+/*
+ * Transport of messages to active object. Each transport provides mailbox<M> with:
+ * put(lane, msg, timeout)  - producers, queue message and wake consumer
+ * wait(max, timeout)       - consumer, returns how many messages may be taken (0 on timeout)
+ * take(msg)                - consumer, get message from the highest non-empty lane
+ * drop_oldest(lane, msg)   - producers, remove oldest message of lane to make space
+ */
+
+/* Kernel message queue per lane, counting semaphore wakes consumer */
+struct os_queue_transport
+{
+    /* Queue storage is provided in active_object_memory */
+    static constexpr bool kernel_queues = true;
+
+    template<typename M>
+    class mailbox
+    {
+    public:
+        mailbox(const std::string_view &name, uint32_t queue_size, const active_object_memory &memory)
+        {
+            /* Create queue of messages for each lane */
+            for (size_t i = 0; i < event_lane_count; i++)
+            {
+                this->queue_attr[i].name = name.data();
+                this->queue_attr[i].cb_mem = memory.queues[i].cb;
+                this->queue_attr[i].cb_size = memory.queues[i].cb_size;
+                this->queue_attr[i].mq_mem = memory.queues[i].mem;
+                this->queue_attr[i].mq_size = memory.queues[i].mem_size;
+
+                this->queues[i] = osMessageQueueNew(queue_size, sizeof(M), &this->queue_attr[i]);
+                assert(this->queues[i] != nullptr);
+            }
+
+            /* Create semaphore counting messages queued in all lanes */
+            this->pending_attr.name = name.data();
+            this->pending_attr.cb_mem = memory.pending.cb;
+            this->pending_attr.cb_size = memory.pending.cb_size;
+
+            this->pending = osSemaphoreNew(event_lane_count * queue_size, 0, &this->pending_attr);
+            assert(this->pending != nullptr);
+        }
+
+        ~mailbox()
+        {
+            osStatus_t status;
+
+            for (auto &queue : this->queues)
+            {
+                status = osMessageQueueDelete(queue);
+                assert(status == osOK);
+                queue = nullptr;
+            }
+
+            status = osSemaphoreDelete(this->pending);
+            assert(status == osOK);
+            (void)status;
+            this->pending = nullptr;
+        }
+
+        mailbox(const mailbox&) = delete;
+        mailbox& operator=(const mailbox&) = delete;
+
+        bool put(size_t lane, const M &msg, uint32_t timeout)
+        {
+            if (osMessageQueuePut(this->queues[lane], &msg, 0, timeout) != osOK)
+                return false;
+
+            const osStatus_t status = osSemaphoreRelease(this->pending);
+            assert(status == osOK);
+            (void)status;
+            return true;
+        }
+
+        size_t wait(size_t max, uint32_t timeout)
+        {
+            if (osSemaphoreAcquire(this->pending, timeout) != osOK)
+                return 0;
+
+            /* Take tokens of other pending messages without blocking */
+            size_t count = 1;
+            while (count < max && osSemaphoreAcquire(this->pending, 0) == osOK)
+                count++;
+
+            return count;
+        }
+
+        /* Every token acquired in wait() has a message queued */
+        bool take(M &msg)
+        {
+            for (auto queue : this->queues)
+            {
+                if (osMessageQueueGet(queue, &msg, nullptr, 0) == osOK)
+                    return true;
+            }
+
+            assert(!"Token without message");
+            return false;
+        }
+
+        /* Returns false if no space can be made, msg is left untouched if lane was drained meanwhile */
+        bool drop_oldest(size_t lane, M &msg)
+        {
+            /* Borrow token of the oldest message, so consumer never waits for a message removed here */
+            if (osSemaphoreAcquire(this->pending, 0) != osOK)
+                return false;
+
+            if (osMessageQueueGet(this->queues[lane], &msg, nullptr, 0) != osOK)
+            {
+                /* Lane was drained in the meantime, give the token back */
+                osSemaphoreRelease(this->pending);
+            }
+
+            return true;
+        }
+
+    private:
+        osMessageQueueId_t queues[event_lane_count];
+        osMessageQueueAttr_t queue_attr[event_lane_count] = {};
+        osSemaphoreId_t pending;
+        osSemaphoreAttr_t pending_attr = { 0 };
+    };
+};
+
+/* Push to lock-free queue, when it is full yield first, which lets consumer of the same
+ * priority drain it, then poll every tick */
+template<typename Q, typename M>
+bool push_blocking(Q &queue, const M &msg, uint32_t timeout)
+{
+    constexpr uint32_t max_yields = 16;
+    uint32_t yields = 0;
+
+    while (!queue.push(msg))
+    {
+        if (timeout == 0)
+            return false;
+
+        if (yields < max_yields)
+        {
+            yields++;
+            osThreadYield();
+            continue;
+        }
+
+        osDelay(1);
+
+        if (timeout != osWaitForever)
+            timeout--;
+    }
+
+    return true;
+}
+
+/* Lock-free MPSC queue per lane, so producers don't serialize in kernel, counting semaphore
+ * wakes consumer. Full lane is waited for by blocking put. Messages can't be removed
+ * by producers, so drop_oldest policy behaves like drop_newest. */
+template<size_t depth>
+struct mpsc_transport
+{
+    static constexpr bool kernel_queues = false;
+
+    template<typename M>
+    class mailbox
+    {
+    public:
+        /* Queue size is given by transport depth */
+        mailbox(const std::string_view &name, uint32_t queue_size, const active_object_memory &memory)
+        {
+            this->pending_attr.name = name.data();
+            this->pending_attr.cb_mem = memory.pending.cb;
+            this->pending_attr.cb_size = memory.pending.cb_size;
+
+            this->pending = osSemaphoreNew(event_lane_count * depth, 0, &this->pending_attr);
+            assert(this->pending != nullptr);
+        }
+
+        ~mailbox()
+        {
+            const osStatus_t status = osSemaphoreDelete(this->pending);
+            assert(status == osOK);
+            (void)status;
+            this->pending = nullptr;
+        }
+
+        mailbox(const mailbox&) = delete;
+        mailbox& operator=(const mailbox&) = delete;
+
+        bool put(size_t lane, const M &msg, uint32_t timeout)
+        {
+            if (!push_blocking(this->queues[lane], msg, timeout))
+                return false;
+
+            const osStatus_t status = osSemaphoreRelease(this->pending);
+            assert(status == osOK);
+            (void)status;
+            return true;
+        }
+
+        size_t wait(size_t max, uint32_t timeout)
+        {
+            if (osSemaphoreAcquire(this->pending, timeout) != osOK)
+                return 0;
+
+            size_t count = 1;
+            while (count < max && osSemaphoreAcquire(this->pending, 0) == osOK)
+                count++;
+
+            return count;
+        }
+
+        /* Semaphore is released after message is published, so every token has a message,
+         * but it may sit behind a cell claimed by preempted producer which has not filled it yet */
+        bool take(M &msg)
+        {
+            while (true)
+            {
+                for (auto &queue : this->queues)
+                {
+                    if (queue.pop(msg))
+                        return true;
+                }
+
+                /* Let the producer finish, it may have lower priority */
+                osDelay(1);
+            }
+        }
+
+        bool drop_oldest(size_t lane, M &msg)
+        {
+            return false;
+        }
+
+    private:
+        libs::mpsc_queue<M, depth> queues[event_lane_count];
+        osSemaphoreId_t pending;
+        osSemaphoreAttr_t pending_attr = { 0 };
+    };
+};
+
+/* Lock-free MPSC queue per lane, consumer is woken with thread flag (task notification)
+ * only when it is about to sleep, so no kernel object is touched while it keeps up.
+ * Active object of cooperative kernel is woken by the kernel, so it uses no signal at all.
+ * Full lane is waited for by blocking put, drop_oldest behaves like drop_newest. */
+template<size_t depth>
+struct notify_transport
+{
+    static constexpr bool kernel_queues = false;
+
+    /* Thread flag of consumer, other flags are left for the application */
+    static constexpr uint32_t wakeup_flag = 1ul << 0;
+
+    template<typename M>
+    class mailbox
+    {
+    public:
+        mailbox(const std::string_view &name, uint32_t queue_size, const active_object_memory &memory)
+        {
+
+        }
+
+        mailbox(const mailbox&) = delete;
+        mailbox& operator=(const mailbox&) = delete;
+
+        bool put(size_t lane, const M &msg, uint32_t timeout)
+        {
+            if (!push_blocking(this->queues[lane], msg, timeout))
+                return false;
+
+            if (this->sleeping.exchange(false))
+                osThreadFlagsSet(this->consumer.load(std::memory_order_relaxed), wakeup_flag);
+
+            return true;
+        }
+
+        /* Queued messages are not counted, so it returns 'max' when any lane is non-empty */
+        size_t wait(size_t max, uint32_t timeout)
+        {
+            while (this->empty())
+            {
+                if (timeout == 0)
+                    return 0;
+
+                /* Announce sleep and check again, producer either sees the announcement or its message is seen here */
+                this->consumer.store(osThreadGetId(), std::memory_order_relaxed);
+                this->sleeping.store(true);
+
+                if (!this->empty())
+                {
+                    this->sleeping.store(false);
+                    break;
+                }
+
+                /* Flag may be left over from a wakeup which was not needed, then loop checks again */
+                const uint32_t flags = osThreadFlagsWait(wakeup_flag, osFlagsWaitAny, timeout);
+                this->sleeping.store(false);
+
+                if (flags & osFlagsError)
+                    return 0;
+            }
+
+            return max;
+        }
+
+        bool take(M &msg)
+        {
+            for (auto &queue : this->queues)
+            {
+                if (queue.pop(msg))
+                    return true;
+            }
+
+            return false;
+        }
+
+        bool drop_oldest(size_t lane, M &msg)
+        {
+            return false;
+        }
+
+    private:
+        bool empty() const
+        {
+            for (auto &queue : this->queues)
+            {
+                if (!queue.empty())
+                    return false;
+            }
+
+            return true;
+        }
+
+        libs::mpsc_queue<M, depth> queues[event_lane_count];
+        std::atomic<bool> sleeping {false};
+        std::atomic<osThreadId_t> consumer {nullptr};
+    };
+};
+
+}
+
+#endif /* MAILBOX_HPP_ */
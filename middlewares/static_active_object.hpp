@@ -0,0 +1,134 @@
+/*
+ * static_active_object.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef STATIC_ACTIVE_OBJECT_HPP_
+#define STATIC_ACTIVE_OBJECT_HPP_
+
+#include "FreeRTOS.h"
+
+#include <middlewares/active_object.hpp>
+
+namespace middlewares
+{
+
+/* Thread control block and stack */
+template<size_t stack_bytes>
+struct static_thread_storage
+{
+    static_assert(configSUPPORT_STATIC_ALLOCATION == 1, "Static allocation must be enabled in FreeRTOSConfig.h");
+    static_assert(stack_bytes % sizeof(StackType_t) == 0, "Stack size must be multiple of stack word");
+
+    StaticTask_t cb;
+    StackType_t stack[stack_bytes / sizeof(StackType_t)] __attribute__((aligned(8)));
+};
+
+/* Active object dispatched by cooperative kernel has no thread */
+template<>
+struct static_thread_storage<0>
+{
+
+};
+
+/* Kernel message queues of lanes */
+template<size_t queue_depth, size_t message_size, bool kernel_queues>
+struct static_queue_storage
+{
+    StaticQueue_t cb[event_lane_count];
+    uint8_t mem[event_lane_count][queue_depth * message_size] __attribute__((aligned(4)));
+};
+
+/* Transport keeps lanes inside itself */
+template<size_t queue_depth, size_t message_size>
+struct static_queue_storage<queue_depth, message_size, false>
+{
+
+};
+
+/* Storage of kernel objects for active object, kept inside the object itself */
+template<size_t stack_bytes, size_t queue_depth, size_t message_size, bool kernel_queues = true>
+class static_active_object_storage
+{
+    static_assert(configSUPPORT_STATIC_ALLOCATION == 1, "Static allocation must be enabled in FreeRTOSConfig.h");
+
+protected:
+    active_object_memory memory()
+    {
+        active_object_memory memory {};
+
+        if constexpr (stack_bytes > 0)
+            memory.thread = { &this->thread.cb, sizeof(this->thread.cb), this->thread.stack, sizeof(this->thread.stack) };
+
+        if constexpr (kernel_queues)
+        {
+            for (size_t i = 0; i < event_lane_count; i++)
+                memory.queues[i] = { &this->queues.cb[i], sizeof(this->queues.cb[i]), this->queues.mem[i], sizeof(this->queues.mem[i]) };
+        }
+
+        memory.pending = { &this->pending_cb, sizeof(this->pending_cb), nullptr, 0 };
+
+        return memory;
+    }
+
+private:
+    static_thread_storage<stack_bytes> thread;
+    static_queue_storage<queue_depth, message_size, kernel_queues> queues;
+    StaticSemaphore_t pending_cb;
+};
+
+/* Event pool of static active object is large enough to hold all lanes full
+ * plus a batch being dispatched, so it never runs out of events */
+template<typename T, size_t queue_depth, size_t max_batch, typename transport>
+using static_active_object_base = active_object<T, event_lane_count * queue_depth + max_batch, max_batch, transport>;
+
+/* Active object which does not use heap at all.
+ * Place the object in linker section to choose RAM bank, e.g.:
+ * static controller ctrl __attribute__((section(".dtcmram")));
+ * With stack_bytes = 0 it has no thread and must be attached to cooperative kernel.
+ * Lock-free transport must have depth equal to queue_depth, e.g. mpsc_transport<queue_depth>. */
+template<typename T, size_t stack_bytes, size_t queue_depth, size_t max_batch = 1, typename transport = os_queue_transport>
+class static_active_object :
+    private static_active_object_storage<stack_bytes, queue_depth,
+                                         sizeof(typename static_active_object_base<T, queue_depth, max_batch, transport>::message),
+                                         transport::kernel_queues>,
+    public static_active_object_base<T, queue_depth, max_batch, transport>
+{
+    using base = static_active_object_base<T, queue_depth, max_batch, transport>;
+    using storage = static_active_object_storage<stack_bytes, queue_depth, sizeof(typename base::message), transport::kernel_queues>;
+
+public:
+    static_active_object(const std::string_view &name, osPriority_t priority) :
+        storage {}, base {name, priority, stack_bytes, queue_depth, storage::memory()}
+    {
+        static_assert(stack_bytes > 0, "Active object with own thread needs stack");
+    }
+
+    static_active_object(const std::string_view &name, cooperative_kernel &kernel, uint8_t priority) :
+        storage {}, base {name, kernel, priority, queue_depth, storage::memory()}
+    {
+        static_assert(stack_bytes == 0, "Active object dispatched by kernel does not use own stack");
+    }
+};
+
+/* Cooperative kernel with thread allocated inside the object */
+template<size_t stack_bytes>
+class static_cooperative_kernel :
+    private static_thread_storage<stack_bytes>,
+    public cooperative_kernel
+{
+    using storage = static_thread_storage<stack_bytes>;
+
+public:
+    static_cooperative_kernel(const std::string_view &name, osPriority_t priority) :
+        storage {}, cooperative_kernel {name, priority, stack_bytes, { &this->cb, sizeof(this->cb), this->stack, sizeof(this->stack) }}
+    {
+
+    }
+};
+
+}
+
+#endif /* STATIC_ACTIVE_OBJECT_HPP_ */
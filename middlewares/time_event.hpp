@@ -0,0 +1,126 @@
+/*
+ * time_event.hpp
+ *
+ *  Created on: 18 paź 2026
+ *      Author: kwarc
+ */
+
+#ifndef TIME_EVENT_HPP_
+#define TIME_EVENT_HPP_
+
+#include "cmsis_os2.h"
+
+#include <libs/timer_wheel.hpp>
+
+#include <middlewares/active_object.hpp>
+
+#include <utility>
+#include <cassert>
+
+namespace middlewares
+{
+
+/* Drives time events of all active objects with single RTOS timer and timing wheel */
+class time_event_service final
+{
+public:
+    time_event_service() = delete;
+
+    /* Must be called from thread before any time event is armed */
+    static void start(uint32_t tick_period_ms = 1)
+    {
+        assert(timer == nullptr);
+        tick_ms = tick_period_ms;
+
+        timer = osTimerNew(on_tick, osTimerPeriodic, nullptr, nullptr);
+        assert(timer != nullptr);
+
+        const osStatus_t status = osTimerStart(timer, tick_ms * osKernelGetTickFreq() / 1000);
+        assert(status == osOK);
+        (void)status;
+    }
+
+    static void arm(libs::timer_node &node, uint32_t timeout_ms, uint32_t period_ms)
+    {
+        const int32_t lock = osKernelLock();
+        wheel.arm(node, to_ticks(timeout_ms), to_ticks(period_ms));
+        osKernelRestoreLock(lock);
+    }
+
+    static void cancel(libs::timer_node &node)
+    {
+        const int32_t lock = osKernelLock();
+        wheel.cancel(node);
+        osKernelRestoreLock(lock);
+    }
+
+private:
+    static uint32_t to_ticks(uint32_t ms)
+    {
+        return (ms + tick_ms - 1) / tick_ms;
+    }
+
+    /* Runs in timer thread, expired handlers only post events without blocking */
+    static void on_tick(void *arg)
+    {
+        const int32_t lock = osKernelLock();
+        wheel.tick();
+        osKernelRestoreLock(lock);
+    }
+
+    static inline osTimerId_t timer;
+    static inline uint32_t tick_ms;
+    static inline libs::timer_wheel<> wheel;
+};
+
+/* One-shot or periodic timeout delivered as an ordinary event into owner's queue.
+ * Event may still be queued after disarm(), so handler should tolerate late timeout. */
+template<typename T>
+class time_event : private libs::timer_node
+{
+public:
+    time_event(T &owner, typename T::event &&e) :
+        owner {owner}, evt {std::move(e.data), T::event::flags::immutable}
+    {
+        this->expired = time_event::post;
+    }
+
+    ~time_event()
+    {
+        this->disarm();
+    }
+
+    time_event(const time_event&) = delete;
+    time_event& operator=(const time_event&) = delete;
+
+    void arm(uint32_t timeout_ms, uint32_t period_ms = 0)
+    {
+        time_event_service::arm(*this, timeout_ms, period_ms);
+    }
+
+    void disarm()
+    {
+        time_event_service::cancel(*this);
+    }
+
+    bool is_armed() const
+    {
+        return this->armed();
+    }
+
+private:
+    static void post(libs::timer_node &node)
+    {
+        auto &self = static_cast<time_event&>(node);
+
+        /* Timeout which is still waiting in queue is not duplicated */
+        self.owner.try_send(self.evt, overflow_policy::coalesce);
+    }
+
+    T &owner;
+    const typename T::event evt;
+};
+
+}
+
+#endif /* TIME_EVENT_HPP_ */
@@ -71,7 +71,7 @@
 #define configHEAP_CLEAR_MEMORY_ON_FREE         1
 
 /* Memory allocation related definitions. */
-#define configSUPPORT_STATIC_ALLOCATION             0
+#define configSUPPORT_STATIC_ALLOCATION             1
 #define configSUPPORT_DYNAMIC_ALLOCATION            1
 #define configTOTAL_HEAP_SIZE                       (32 * 1024)
 //#define configAPPLICATION_ALLOCATED_HEAP            1